@@ -0,0 +1,481 @@
+// Host only, not part of the firmware build; see sequencer-port-sim.h.
+//
+//   fluke8050-decoder-test [-w] dir
+//
+// Replays the captures in dir through fluke8050_decode() and checks every
+// reading that comes out, and how many scans were dropped as torn:
+//
+//   clean.cap  two meters on one capture, one with its data on GPIO32-39
+//              wired out of order (data_lut), one with a strobe there
+//   torn.cap   a skipped latch, two latches swapped, overlapping strobes
+//              and a scan restarted halfway, between clean scans
+//   gap.cap    half a scan, a pause, then the other half of the next one,
+//              which only the gap check can tell from a whole scan
+//
+// A capture is one sample per line, "in in1 dt" in hex as capture_drain()
+// returns them. These ones were written by -w from the scans below, with
+// the 8050A's latch order and timing; a capture logged from a meter in the
+// same format can be dropped in beside them.
+#ifdef SEQUENCER_HOST
+#include "fluke8050-decoder.h"
+#include "inttypes.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+
+#define MAX_SAMPLES 4096
+#define MAX_EVENTS (MAX_SAMPLES * 2)
+#define MAX_READINGS 16
+
+// CPU cycles at 240MHz: data settles before the strobe rises, latches are
+// LATCH_CYCLES apart, and the meter idles between scans.
+#define SETTLE_CYCLES 480
+#define HOLD_CYCLES 2400
+#define LATCH_CYCLES 4800
+#define SCAN_GAP_CYCLES 480000
+#define PAUSE_CYCLES 120000
+// 100us, well past the gaps inside a scan and well short of SCAN_GAP.
+#define MAX_GAP_CYCLES 24000
+
+typedef enum fault {
+    FAULT_NONE,
+    FAULT_SKIP,     // U13 never strobes
+    FAULT_SWAP,     // U14 strobes before U13
+    FAULT_OVERLAP,  // U13's strobe rises while U12's is still high
+    FAULT_RESTART,  // Stops after U12 and starts over with U10
+    FAULT_SPLIT     // Pauses after U13 and goes on with the next reading
+} fault_t;
+
+typedef struct meter_pins {
+    uint8_t strobe_pins[FLUKE8050_STROBES];
+    uint8_t data_pins[4];
+} meter_pins_t;
+
+// Data on GPIO32-39 in a scrambled order, BCD bit 0 first.
+static const meter_pins_t meter_a = {
+    .strobe_pins = {16, 17, 18, 19, 21, 22, 23},
+    .data_pins = {36, 33, 39, 34},
+};
+// Data on GPIO0-31 and the last strobe on GPIO38.
+static const meter_pins_t meter_b = {
+    .strobe_pins = {4, 5, 12, 13, 14, 15, 38},
+    .data_pins = {26, 27, 2, 3},
+};
+
+typedef struct bus_event {
+    uint64_t t;
+    uint32_t order;  // Keeps events at the same t in the order put
+    uint8_t pin;
+    bool level;
+} bus_event_t;
+
+static bus_event_t events[MAX_EVENTS];
+static size_t event_count = 0;
+static capture_sample_t samples[MAX_SAMPLES];
+static size_t sample_count = 0;
+static uint32_t failures = 0;
+
+#define EXPECT(X, ...)                                 \
+    if (!(X)) {                                        \
+        printf("%s:%d: %s: ", __FILE__, __LINE__, #X); \
+        printf(__VA_ARGS__);                           \
+        printf("\n");                                  \
+        failures++;                                    \
+    }
+
+static fluke8050_reading_t reading(uint8_t ind, uint8_t sign, uint8_t dec,
+                                   uint8_t d0, uint8_t d1, uint8_t d2,
+                                   uint8_t d3) {
+    fluke8050_reading_t r = {.indicator_mask = ind,
+                             .sign_mask = SIGN_BP | sign,
+                             .decimal_mask = dec,
+                             .digits = {d0, d1, d2, d3}};
+    return r;
+}
+
+static uint8_t nibble_of(const fluke8050_reading_t *r, int latch) {
+    if (latch == LATCH_U10) {
+        return r->indicator_mask;
+    } else if (latch == LATCH_U11) {
+        return r->sign_mask;
+    } else if (latch == LATCH_U16) {
+        return r->decimal_mask;
+    }
+    return r->digits[latch - LATCH_U12];
+}
+
+static bool same_reading(const fluke8050_reading_t *a,
+                         const fluke8050_reading_t *b) {
+    if (a->indicator_mask != b->indicator_mask ||
+        a->sign_mask != b->sign_mask || a->decimal_mask != b->decimal_mask) {
+        return false;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (a->digits[i] != b->digits[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void put(uint64_t t, uint8_t pin, bool level) {
+    if (event_count < MAX_EVENTS) {
+        events[event_count] = (bus_event_t){t, event_count, pin, level};
+        event_count++;
+    }
+}
+
+// One latch: data settles, then the strobe is held high and dropped.
+static void put_latch(const meter_pins_t *m, uint64_t t, int latch,
+                      uint8_t nibble) {
+    for (int b = 0; b < 4; b++) {
+        put(t, m->data_pins[b], nibble & BIT(b));
+    }
+    put(t + SETTLE_CYCLES, m->strobe_pins[latch], true);
+    put(t + SETTLE_CYCLES + HOLD_CYCLES, m->strobe_pins[latch], false);
+}
+
+// A scan of r starting at t, or of r up to U13 and next after it for
+// FAULT_SPLIT. Returns when the meter is ready to start another.
+static uint64_t put_scan(const meter_pins_t *m, uint64_t t,
+                         const fluke8050_reading_t *r, fault_t fault,
+                         const fluke8050_reading_t *next) {
+    for (int latch = 0; latch < FLUKE8050_STROBES; latch++) {
+        const fluke8050_reading_t *from = r;
+        int at = latch;
+        if (fault == FAULT_SKIP && latch == LATCH_U13) {
+            t += LATCH_CYCLES;
+            continue;
+        } else if (fault == FAULT_SWAP && latch == LATCH_U13) {
+            at = LATCH_U14;
+        } else if (fault == FAULT_SWAP && latch == LATCH_U14) {
+            at = LATCH_U13;
+        } else if (fault == FAULT_RESTART && latch == LATCH_U13) {
+            return put_scan(m, t, r, FAULT_NONE, NULL);
+        } else if (fault == FAULT_SPLIT && latch >= LATCH_U14) {
+            from = next;
+        }
+        if (fault == FAULT_SPLIT && latch == LATCH_U14) {
+            t += PAUSE_CYCLES;
+        }
+        if (fault == FAULT_OVERLAP && latch == LATCH_U13) {
+            // Rises halfway through U12's strobe, on U12's data.
+            uint64_t rise = t - LATCH_CYCLES + SETTLE_CYCLES + HOLD_CYCLES / 2;
+            put(rise, m->strobe_pins[at], true);
+            put(t + SETTLE_CYCLES + HOLD_CYCLES, m->strobe_pins[at], false);
+        } else {
+            put_latch(m, t, at, nibble_of(from, at));
+        }
+        t += LATCH_CYCLES;
+    }
+    return t + SCAN_GAP_CYCLES;
+}
+
+static int event_cmp(const void *a, const void *b) {
+    const bus_event_t *x = a;
+    const bus_event_t *y = b;
+    if (x->t != y->t) {
+        return x->t < y->t ? -1 : 1;
+    }
+    return x->order < y->order ? -1 : 1;
+}
+
+// What CAPTURE_EDGE would have sampled: one sample per change of any pin,
+// with the time since the previous sample saturating at 16 bits.
+static void events_to_samples() {
+    qsort(events, event_count, sizeof(events[0]), event_cmp);
+    uint64_t pins = 0;
+    uint64_t sampled = 0;
+    uint64_t last_t = 0;
+    sample_count = 0;
+    for (size_t i = 0; i < event_count; i++) {
+        if (events[i].level) {
+            pins |= 1ULL << events[i].pin;
+        } else {
+            pins &= ~(1ULL << events[i].pin);
+        }
+        if (i + 1 < event_count && events[i + 1].t == events[i].t) {
+            continue;
+        }
+        if (pins == sampled || sample_count == MAX_SAMPLES) {
+            continue;
+        }
+        sampled = pins;
+        uint64_t dt = events[i].t - last_t;
+        last_t = events[i].t;
+        samples[sample_count++] = (capture_sample_t){
+            .in = (uint32_t)pins,
+            .in1 = (uint8_t)(pins >> 32),
+            .dt = dt > 0xFFFF ? 0xFFFF : dt,
+        };
+    }
+    event_count = 0;
+}
+
+static const fluke8050_reading_t *readings_a() {
+    static fluke8050_reading_t r[8];
+    r[0] = reading(0, SIGN_PLUS | SIGN_ONE, D1, 2, 3, 4, 5);
+    r[1] = reading(IND_REL, SIGN_MINUS, D0, 0, 9, 8, 7);
+    r[2] = reading(IND_BAT, SIGN_PLUS, D2, 6, 0, 1, 2);
+    r[3] = reading(IND_HV | IND_DB, SIGN_MINUS | SIGN_ONE, D3, 9, 9, 9, 9);
+    r[4] = reading(0, SIGN_PLUS, D3, 1, 5, 0, 3);
+    r[5] = reading(IND_DB, SIGN_MINUS, D1, CD4056_OFF, CD4056_L, 0, 8);
+    r[6] = reading(0, SIGN_PLUS, D2, 4, 4, 4, 4);
+    r[7] = reading(IND_REL | IND_BAT, SIGN_PLUS | SIGN_ONE, D0, 8, 1, 7, 0);
+    return r;
+}
+
+static const fluke8050_reading_t *readings_b() {
+    static fluke8050_reading_t r[4];
+    r[0] = reading(0, SIGN_PLUS, D0, 1, 0, 0, 0);
+    r[1] = reading(IND_HV, SIGN_MINUS, D1, 3, 1, 4, 1);
+    r[2] = reading(0, SIGN_PLUS | SIGN_ONE, D2, 5, 9, 2, 6);
+    r[3] = reading(IND_REL, SIGN_PLUS, D3, CD4056_DASH, 7, 7, 7);
+    return r;
+}
+
+static void build_clean() {
+    const fluke8050_reading_t *a = readings_a();
+    const fluke8050_reading_t *b = readings_b();
+    // Meter b runs on its own clock, so its edges land all over a's scans.
+    uint64_t ta = 0;
+    uint64_t tb = 1234;
+    for (int i = 0; i < 8; i++) {
+        ta = put_scan(&meter_a, ta, &a[i], FAULT_NONE, NULL);
+    }
+    for (int i = 0; i < 4; i++) {
+        tb = put_scan(&meter_b, tb, &b[i], FAULT_NONE, NULL) + 777777;
+    }
+    events_to_samples();
+}
+
+static const fault_t torn_faults[] = {FAULT_NONE, FAULT_SKIP,    FAULT_NONE,
+                                      FAULT_SWAP, FAULT_NONE,    FAULT_OVERLAP,
+                                      FAULT_NONE, FAULT_RESTART, FAULT_NONE};
+
+static void build_torn() {
+    const fluke8050_reading_t *a = readings_a();
+    uint64_t t = 0;
+    for (int i = 0; i < 9; i++) {
+        t = put_scan(&meter_a, t, &a[i % 8], torn_faults[i], NULL);
+    }
+    events_to_samples();
+}
+
+static void build_gap() {
+    const fluke8050_reading_t *a = readings_a();
+    uint64_t t = 0;
+    t = put_scan(&meter_a, t, &a[0], FAULT_NONE, NULL);
+    t = put_scan(&meter_a, t, &a[1], FAULT_SPLIT, &a[2]);
+    t = put_scan(&meter_a, t, &a[3], FAULT_NONE, NULL);
+    events_to_samples();
+}
+
+static bool write_capture(const char *dir, const char *name) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        printf("%s: can't write\n", path);
+        return false;
+    }
+    fprintf(f, "# in in1 dt, written by fluke8050-decoder-test -w\n");
+    for (size_t i = 0; i < sample_count; i++) {
+        fprintf(f, "%08" PRIx32 " %02x %04x\n", samples[i].in, samples[i].in1,
+                samples[i].dt);
+    }
+    fclose(f);
+    printf("%s: %u samples\n", path, (unsigned)sample_count);
+    return true;
+}
+
+static bool read_capture(const char *dir, const char *name) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        printf("%s: can't read\n", path);
+        return false;
+    }
+    char line[64];
+    sample_count = 0;
+    while (fgets(line, sizeof(line), f) != NULL && sample_count < MAX_SAMPLES) {
+        unsigned in, in1, dt;
+        if (line[0] == '#' || sscanf(line, "%x %x %x", &in, &in1, &dt) != 3) {
+            continue;
+        }
+        samples[sample_count++] =
+            (capture_sample_t){.in = in, .in1 = in1, .dt = dt};
+    }
+    fclose(f);
+    return sample_count != 0;
+}
+
+static size_t decode_all(const meter_pins_t *m, uint32_t max_gap_cycles,
+                         fluke8050_decoder_t *d, fluke8050_reading_t *out) {
+    size_t n = 0;
+    EXPECT(fluke8050_decoder_init(d, m->strobe_pins, m->data_pins,
+                                  max_gap_cycles),
+           "pin map");
+    for (size_t i = 0; i < sample_count; i++) {
+        fluke8050_reading_t r;
+        if (fluke8050_decode(d, &samples[i], &r) && n < MAX_READINGS) {
+            out[n++] = r;
+        }
+    }
+    return n;
+}
+
+static void expect_readings(const char *what, const fluke8050_reading_t *got,
+                            size_t n, const fluke8050_reading_t *const *want,
+                            size_t count) {
+    EXPECT(n == count, "%s: %u readings, want %u", what, (unsigned)n,
+           (unsigned)count);
+    for (size_t i = 0; i < n && i < count; i++) {
+        EXPECT(same_reading(&got[i], want[i]),
+               "%s: reading %u is %x %x %x %x%x%x%x", what, (unsigned)i,
+               got[i].indicator_mask, got[i].sign_mask, got[i].decimal_mask,
+               got[i].digits[0], got[i].digits[1], got[i].digits[2],
+               got[i].digits[3]);
+    }
+}
+
+// data_lut maps each of meter a's GPIO32-39 data pins to its BCD bit, and
+// nothing else on GPIO32-39 is its data.
+static void check_lut() {
+    fluke8050_decoder_t d;
+    fluke8050_decoder_init(&d, meter_a.strobe_pins, meter_a.data_pins, 0);
+    for (int b = 0; b < 4; b++) {
+        uint8_t raw = 1 << (meter_a.data_pins[b] - 32);
+        EXPECT(d.data_lut[raw] == BIT(b), "GPIO%u is bit %d",
+               meter_a.data_pins[b], b);
+    }
+    EXPECT(d.data_lut[0xFF] == 0xF, "all pins high");
+    EXPECT(d.in1_mask == 0x96, "in1_mask %02x", d.in1_mask);
+    EXPECT(d.in_mask == 0xEF0000, "in_mask %08" PRIx32, d.in_mask);
+}
+
+static void check_clean() {
+    const fluke8050_reading_t *a = readings_a();
+    const fluke8050_reading_t *b = readings_b();
+    fluke8050_decoder_t d;
+    fluke8050_reading_t got[MAX_READINGS];
+    const fluke8050_reading_t *want[8];
+
+    for (int gap = 0; gap < 2; gap++) {
+        uint32_t max_gap = gap ? MAX_GAP_CYCLES : 0;
+        size_t n = decode_all(&meter_a, max_gap, &d, got);
+        for (int i = 0; i < 8; i++) {
+            want[i] = &a[i];
+        }
+        expect_readings("clean a", got, n, want, 8);
+        EXPECT(d.torn == 0, "clean a: %" PRIu32 " torn", d.torn);
+
+        n = decode_all(&meter_b, max_gap, &d, got);
+        for (int i = 0; i < 4; i++) {
+            want[i] = &b[i];
+        }
+        expect_readings("clean b", got, n, want, 4);
+        EXPECT(d.torn == 0, "clean b: %" PRIu32 " torn", d.torn);
+    }
+
+    // The first of a's readings as a number: 12345 with the point after
+    // the 12 is 12.345.
+    int32_t value = 0;
+    EXPECT(fluke8050_reading_value(&a[0], &value) && value == 123450,
+           "value %" PRId32, value);
+    EXPECT(!fluke8050_reading_value(&a[5], &value), "blank digit");
+}
+
+static void check_torn() {
+    const fluke8050_reading_t *a = readings_a();
+    fluke8050_decoder_t d;
+    fluke8050_reading_t got[MAX_READINGS];
+    const fluke8050_reading_t *want[9];
+    size_t count = 0;
+    for (int i = 0; i < 9; i++) {
+        if (torn_faults[i] == FAULT_NONE || torn_faults[i] == FAULT_RESTART) {
+            want[count++] = &a[i % 8];
+        }
+    }
+
+    for (int gap = 0; gap < 2; gap++) {
+        size_t n = decode_all(&meter_a, gap ? MAX_GAP_CYCLES : 0, &d, got);
+        expect_readings("torn", got, n, want, count);
+        EXPECT(d.torn == 4, "%" PRIu32 " torn", d.torn);
+    }
+}
+
+static void check_gap() {
+    const fluke8050_reading_t *a = readings_a();
+    fluke8050_decoder_t d;
+    fluke8050_reading_t got[MAX_READINGS];
+
+    // The halves join up into a reading the meter never showed.
+    fluke8050_reading_t stitched = a[1];
+    for (int i = LATCH_U14; i <= LATCH_U15; i++) {
+        stitched.digits[i - LATCH_U12] = a[2].digits[i - LATCH_U12];
+    }
+    stitched.decimal_mask = a[2].decimal_mask;
+    const fluke8050_reading_t *unchecked[] = {&a[0], &stitched, &a[3]};
+    size_t n = decode_all(&meter_a, 0, &d, got);
+    expect_readings("gap unchecked", got, n, unchecked, 3);
+    EXPECT(d.torn == 0, "gap unchecked: %" PRIu32 " torn", d.torn);
+
+    const fluke8050_reading_t *checked[] = {&a[0], &a[3]};
+    n = decode_all(&meter_a, MAX_GAP_CYCLES, &d, got);
+    expect_readings("gap", got, n, checked, 2);
+    EXPECT(d.torn == 1, "gap: %" PRIu32 " torn", d.torn);
+}
+
+typedef struct capture_file {
+    const char *name;
+    void (*build)();
+    void (*check)();
+} capture_file_t;
+
+static const capture_file_t captures[] = {
+    {"clean.cap", build_clean, check_clean},
+    {"torn.cap", build_torn, check_torn},
+    {"gap.cap", build_gap, check_gap},
+};
+
+int main(int argc, char **argv) {
+    bool write = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "w")) != -1) {
+        if (opt == 'w') {
+            write = true;
+        } else {
+            optind = argc;
+            break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "usage: %s [-w] dir\n", argv[0]);
+        return 2;
+    }
+    const char *dir = argv[optind];
+
+    check_lut();
+    for (size_t i = 0; i < sizeof(captures) / sizeof(captures[0]); i++) {
+        if (write) {
+            captures[i].build();
+            if (!write_capture(dir, captures[i].name)) {
+                return 1;
+            }
+            continue;
+        }
+        if (!read_capture(dir, captures[i].name)) {
+            failures++;
+            continue;
+        }
+        uint32_t before = failures;
+        captures[i].check();
+        printf("%s: %u samples, %s\n", captures[i].name,
+               (unsigned)sample_count, failures == before ? "ok" : "FAILED");
+    }
+    return failures == 0 ? 0 : 1;
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+// LVGL for the host render harness, set as sdkconfig's CONFIG_LV_* are for
+// the board so the host draws the same pixels. Anything not set here is
+// LVGL's default, as it is on the board. Colors are not byte swapped: that
+// only suits the panel's SPI transfers.
+#define LV_HOR_RES_MAX 240
+#define LV_VER_RES_MAX 135
+#define LV_COLOR_DEPTH 16
+#define LV_COLOR_16_SWAP 0
+#define LV_ANTIALIAS 1
+#define LV_DPI 130
+#define LV_DISP_DEF_REFR_PERIOD 30
+#define LV_MEM_SIZE (32U * 1024U)
+#define LV_TICK_CUSTOM 0
+#define LV_USE_LOG 0
+
+#define LV_FONT_MONTSERRAT_12 1
+#define LV_FONT_MONTSERRAT_16 1
+#define LV_FONT_MONTSERRAT_40 1
+
+#define LV_USE_THEME_EMPTY 1
+#define LV_THEME_DEFAULT_INCLUDE <stdint.h>
+#define LV_THEME_DEFAULT_INIT lv_theme_empty_init
+#define LV_THEME_DEFAULT_COLOR_PRIMARY LV_COLOR_BLACK
+#define LV_THEME_DEFAULT_COLOR_SECONDARY LV_COLOR_GREEN
+#define LV_THEME_DEFAULT_FLAG 0
+#define LV_THEME_DEFAULT_FONT_SMALL &lv_font_montserrat_12
+#define LV_THEME_DEFAULT_FONT_NORMAL &lv_font_montserrat_12
+#define LV_THEME_DEFAULT_FONT_SUBTITLE &lv_font_montserrat_12
+#define LV_THEME_DEFAULT_FONT_TITLE &lv_font_montserrat_12
+
+#define LV_TXT_ENC LV_TXT_ENC_ASCII
@@ -0,0 +1,284 @@
+// Host only, not part of the firmware build; see display-port-sim.h.
+//
+//   render-harness [-n updates] [-g dir [-w]]
+//
+// Without -g it times reading updates on the first meter's screen, 1000 or
+// -n of them: each reading is published, woken for and drawn as the bus
+// task and the display task do on the board, and the display task's pass
+// is timed on the host's clock.
+//
+// With -g it draws each scene below and compares the frame with
+// dir/<scene>.ppm, writing dir/<scene>.actual.ppm for any that differ, and
+// exits 1 if one did. A scene with no reference is skipped; if none
+// differed but some were skipped the exit is 77, which ctest reports as
+// skipped rather than passed. -w writes the references instead; the render-golden test runs it
+// against main/host/golden. Simulated time makes the frames repeatable, so
+// any pixel that moves is a change in rendering.
+#ifdef DISPLAY_HOST
+#include "display-port-sim.h"
+
+#include "inttypes.h"
+#include "screen-core.h"
+#include "string.h"
+#include "time.h"
+#include "unistd.h"
+
+#define WIDTH CONFIG_LV_DISPLAY_WIDTH
+#define HEIGHT CONFIG_LV_DISPLAY_HEIGHT
+// Long enough for the once a second title and stats, a screen's slide in
+// and the trend's redraw.
+#define SCENE_MS 1500
+// Past set_max_fps()'s default 30 fps, so every update is drawn.
+#define UPDATE_MS 40
+
+// Exit code for a run with references missing, see SKIP_RETURN_CODE in
+// CMakeLists.txt.
+#define EXIT_SKIPPED 77
+
+typedef struct scene {
+    const char *name;
+    display_mode_t mode;
+    uint32_t n;        // Shown as in counting_reading()
+    uint8_t indicators;
+    uint16_t history;  // Readings counting up to n published first
+} scene_t;
+
+static const scene_t scenes[] = {
+    {"volts", FLUKE_8050A, 1234, 0, 0},
+    {"negative-rel", FLUKE_8050A, 10012, IND_REL, 0},
+    {"indicators", FLUKE_8050A, 56, IND_BAT | IND_HV | IND_DB, 0},
+    {"seg7", FLUKE_8050A_SEG7, 1234, 0, 0},
+    {"trend", TREND, 2400, 0, 400},
+};
+
+static uint8_t rgb[WIDTH * HEIGHT * 3];
+static uint8_t golden[WIDTH * HEIGHT * 3];
+
+// Counting up by one, so the last digit changes every reading and the
+// others as often as they would with a drifting input.
+static void counting_reading(uint32_t n, uint8_t indicators,
+                             fluke8050_reading_t *r) {
+    memset(r, 0, sizeof(*r));
+    r->indicator_mask = indicators;
+    r->sign_mask = SIGN_BP | ((n / 10000) & 1 ? SIGN_MINUS : SIGN_PLUS);
+    if ((n / 20000) & 1) {
+        r->sign_mask |= SIGN_ONE;
+    }
+    r->decimal_mask = D1;
+    for (int i = 3; i >= 0; i--) {
+        r->digits[i] = n % 10;
+        n /= 10;
+    }
+}
+
+// A display task wakeup every tick, as if LVGL always had something due.
+static void run_ms(display_handle_t disp, uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += portTICK_PERIOD_MS) {
+        sim_advance_us(portTICK_PERIOD_MS * 1000);
+        display_host_step(disp);
+    }
+}
+
+static uint64_t host_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void frame_rgb() {
+    const lv_color_t *px = sim_framebuffer();
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        uint32_t c = lv_color_to32(px[i]);
+        rgb[i * 3] = c >> 16;
+        rgb[i * 3 + 1] = c >> 8;
+        rgb[i * 3 + 2] = c;
+    }
+}
+
+// Binary PPM, 8 bits a channel, which most image viewers open.
+static void ppm_header(char *out, size_t size) {
+    snprintf(out, size, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+}
+
+static bool write_ppm(const char *path) {
+    char header[32];
+    ppm_header(header, sizeof(header));
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    bool ok = fputs(header, f) >= 0 && fwrite(rgb, sizeof(rgb), 1, f) == 1;
+    return fclose(f) == 0 && ok;
+}
+
+static bool read_ppm(const char *path) {
+    char expect[32], header[32] = {0};
+    ppm_header(expect, sizeof(expect));
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    bool ok = fread(header, strlen(expect), 1, f) == 1 &&
+              strcmp(header, expect) == 0 &&
+              fread(golden, sizeof(golden), 1, f) == 1;
+    fclose(f);
+    return ok;
+}
+
+// Pixels that differ from the reference and the box around them.
+static uint32_t compare(lv_area_t *box) {
+    uint32_t diff = 0;
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            int i = (y * WIDTH + x) * 3;
+            if (memcmp(&rgb[i], &golden[i], 3) == 0) {
+                continue;
+            }
+            if (diff++ == 0) {
+                box->x1 = box->x2 = x;
+                box->y1 = box->y2 = y;
+            }
+            box->x1 = x < box->x1 ? x : box->x1;
+            box->x2 = x > box->x2 ? x : box->x2;
+            box->y2 = y;
+        }
+    }
+    return diff;
+}
+
+typedef enum scene_result {
+    SCENE_OK,
+    SCENE_FAILED,
+    SCENE_NO_REFERENCE
+} scene_result_t;
+
+static scene_result_t check_scene(display_handle_t disp, const scene_t *s,
+                                  const char *dir, bool write) {
+    fluke8050_reading_t r;
+    for (uint32_t i = s->history; i > 0; i--) {
+        counting_reading(s->n - i, s->indicators, &r);
+        sim_bus_publish(0, &r);
+    }
+    counting_reading(s->n, s->indicators, &r);
+    sim_bus_publish(0, &r);
+    show_display(disp, s->mode);
+    run_ms(disp, SCENE_MS);
+    frame_rgb();
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.ppm", dir, s->name);
+    if (write) {
+        if (!write_ppm(path)) {
+            printf("%s: can't write %s\n", s->name, path);
+            return SCENE_FAILED;
+        }
+        printf("%s: wrote %s\n", s->name, path);
+        return SCENE_OK;
+    }
+    if (!read_ppm(path)) {
+        printf("%s: skipped, no reference at %s\n", s->name, path);
+        return SCENE_NO_REFERENCE;
+    }
+    lv_area_t box;
+    uint32_t diff = compare(&box);
+    if (diff == 0) {
+        printf("%s: ok\n", s->name);
+        return SCENE_OK;
+    }
+    snprintf(path, sizeof(path), "%s/%s.actual.ppm", dir, s->name);
+    write_ppm(path);
+    printf("%s: %" PRIu32 " pixels differ in (%d,%d)-(%d,%d), frame in %s\n",
+           s->name, diff, box.x1, box.y1, box.x2, box.y2, path);
+    return SCENE_FAILED;
+}
+
+// Returns the exit code: 1 if any scene failed, else EXIT_SKIPPED if any
+// had no reference to compare with.
+static int check_scenes(display_handle_t disp, const char *dir, bool write) {
+    uint32_t failed = 0;
+    uint32_t missing = 0;
+    for (size_t i = 0; i < sizeof(scenes) / sizeof(scenes[0]); i++) {
+        scene_result_t r = check_scene(disp, &scenes[i], dir, write);
+        failed += r == SCENE_FAILED;
+        missing += r == SCENE_NO_REFERENCE;
+    }
+    if (failed != 0) {
+        return 1;
+    }
+    if (missing != 0) {
+        printf("%" PRIu32 " of %u scenes have no reference in %s, so they "
+               "were not compared; generate them with the "
+               "render-golden-update target and commit them\n",
+               missing, (unsigned)(sizeof(scenes) / sizeof(scenes[0])), dir);
+        return EXIT_SKIPPED;
+    }
+    return 0;
+}
+
+static void bench(display_handle_t disp, uint32_t updates) {
+    fluke8050_reading_t r;
+    counting_reading(0, 0, &r);
+    sim_bus_publish(0, &r);
+    display_wake(disp);
+    run_ms(disp, SCENE_MS);
+
+    display_flush_stats_t before, after;
+    display_get_flush_stats(&before);
+    uint64_t total_ns = 0, max_ns = 0;
+    for (uint32_t i = 1; i <= updates; i++) {
+        counting_reading(i, 0, &r);
+        sim_bus_publish(0, &r);
+        display_wake(disp);
+        sim_advance_us(UPDATE_MS * 1000);
+        uint64_t start = host_ns();
+        display_host_step(disp);
+        uint64_t ns = host_ns() - start;
+        total_ns += ns;
+        if (ns > max_ns) {
+            max_ns = ns;
+        }
+    }
+    display_get_flush_stats(&after);
+
+    uint64_t px = (after.bytes - before.bytes) / sizeof(lv_color_t);
+    printf("bench: %" PRIu32 " updates, %" PRIu64 " ns avg %" PRIu64
+           " ns max per update, %" PRIu64 " px %" PRIu32
+           " areas per update\n",
+           updates, total_ns / updates, max_ns, px / updates,
+           (after.flushes - before.flushes) / updates);
+}
+
+int main(int argc, char **argv) {
+    uint32_t updates = 1000;
+    const char *dir = NULL;
+    bool write = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:g:w")) != -1) {
+        if (opt == 'n') {
+            updates = strtoul(optarg, NULL, 0);
+        } else if (opt == 'g') {
+            dir = optarg;
+        } else if (opt == 'w') {
+            write = true;
+        } else {
+            fprintf(stderr, "usage: %s [-n updates] [-g dir [-w]]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    // Whole seconds, so the once a second draws fall the same way each run.
+    sim_advance_us(1000000);
+    sim_bus_set_meters(1);
+    lv_init();
+    display_handle_t disp = display_host_start(MAX_DISPLAY_MODE + 1);
+
+    if (dir != NULL) {
+        return check_scenes(disp, dir, write);
+    }
+    if (updates != 0) {
+        bench(disp, updates);
+    }
+    return 0;
+}
+#endif
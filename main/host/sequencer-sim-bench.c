@@ -0,0 +1,196 @@
+// Host only, not part of the firmware build; see sequencer-port-sim.h.
+//
+//   sequencer-sim-bench [-m ms]
+//
+// sequencer_benchmark() on the simulated port: pages/s for the same flat
+// and RLE patterns, each played for 200ms or -m, then the latency of bank
+// swaps from request_bank() to cpu1_done(). Every page is recorded and
+// drained as it would be in a test, so the rates are for the simulator, not
+// a prediction for the board. With fewer than two host cores the PRO and APP
+// threads take turns, and the swap latency is mostly the scheduler's slice.
+#ifdef SEQUENCER_HOST
+#include "inttypes.h"
+#include "sequencer-core.h"
+#include "stdlib.h"
+#include "unistd.h"
+
+#define BENCH_GPIO1 (1 << 25)
+#define BENCH_GPIO2 (1 << 26)
+#define BENCH_PAGES 240
+#define BENCH_LONG_LOOPS 100
+#define BENCH_SWAPS 200
+// 100us a page, so a BENCH_PAGES cycle runs well past CPU1_WAIT_SLACK_US.
+#define BENCH_SLOW_PACE 24000
+#define BENCH_EVENTS 4096
+
+static uint32_t bench_ms = 200;
+static gpio_page_t flat[BENCH_PAGES];
+static uint32_t prog[BENCH_PAGES * 3 + 3];
+static sim_event_t events[BENCH_EVENTS];
+static uint32_t drained = 0;
+
+// As in sequencer-bench.c: run is how many times each page repeats.
+static void make_pattern(size_t count, size_t run) {
+    for (size_t i = 0; i < count; i++) {
+        size_t step = i / run;
+        flat[i].set = (step & 1) ? BENCH_GPIO1 : BENCH_GPIO2;
+        flat[i].clear = (step & 1) ? BENCH_GPIO2 : BENCH_GPIO1;
+    }
+}
+
+// Drains the event ring for bench_ms, returning pages/s.
+static uint32_t measure() {
+    uint32_t start = cpu1_counter;
+    int64_t t0 = seq_time_us();
+    int64_t t1 = t0;
+    while (t1 - t0 < (int64_t)bench_ms * 1000) {
+        drained += sim_events(events, BENCH_EVENTS);
+        t1 = seq_time_us();
+    }
+    uint32_t pages = cpu1_counter - start;
+    return (uint64_t)pages * 1000000ULL / (t1 - t0);
+}
+
+static bool bench_flat(const char *name, size_t count) {
+    uint32_t set[BENCH_PAGES];
+    uint32_t clear[BENCH_PAGES];
+    for (size_t i = 0; i < count; i++) {
+        set[i] = flat[i].set;
+        clear[i] = flat[i].clear;
+    }
+    if (!init_gpios(2, count) || !write_set_bank(0, 0, count, set) ||
+        !write_clear_bank(0, 0, count, clear) || !set_active_bank(0)) {
+        printf("%s: flat setup failed\n", name);
+        return false;
+    }
+    uint32_t rate = measure();
+    printf("%s flat: %u pages, %u bytes, %" PRIu32 " pages/s\n", name,
+           (unsigned)count, (unsigned)(count * sizeof(gpio_page_t)), rate);
+    return set_active_bank(0xFF);
+}
+
+// loops > 1 wraps the encoded pattern in an outer RLE_OP_LOOP.
+static bool bench_rle(const char *name, size_t count, uint32_t loops) {
+    size_t words = rle_encode((const uint32_t *)flat, count, prog + 1,
+                              sizeof(prog) / sizeof(prog[0]) - 2);
+    if (words != 0) {
+        prog[0] = RLE_WORD(RLE_OP_LOOP, loops);
+        prog[words] = RLE_WORD(RLE_OP_END, 0);
+        prog[words + 1] = RLE_WORD(RLE_OP_EOP, 0);
+        words += 2;
+    }
+    if (words == 0 || !init_gpios_rle(2, words, PATTERN_MEM_DRAM) ||
+        !write_rle_bank(0, prog, words) || !set_active_bank(0)) {
+        printf("%s: rle setup failed\n", name);
+        return false;
+    }
+    uint32_t rate = measure();
+    printf("%s rle: %u pages, %u bytes, %" PRIu32 " pages/s\n", name,
+           (unsigned)rle_decoded_length(prog, words),
+           (unsigned)(words * sizeof(uint32_t)), rate);
+    return set_active_bank(0xFF);
+}
+
+// Swaps land at the end of a page cycle, so this is mostly how long the
+// rest of the cycle takes.
+static bool bench_swaps(size_t count) {
+    uint32_t set[BENCH_PAGES];
+    uint32_t clear[BENCH_PAGES];
+    for (size_t i = 0; i < count; i++) {
+        set[i] = flat[i].set;
+        clear[i] = flat[i].clear;
+    }
+    if (!init_gpios(2, count) || !write_set_bank(0, 0, count, set) ||
+        !write_clear_bank(0, 0, count, clear) ||
+        !write_set_bank(1, 0, count, clear) ||
+        !write_clear_bank(1, 0, count, set) || !set_active_bank(0)) {
+        printf("swap: setup failed\n");
+        return false;
+    }
+
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t total = 0;
+    for (int i = 0; i < BENCH_SWAPS; i++) {
+        uint32_t start = seq_ccount();
+        uint32_t seq = request_bank((i & 1) ? 0 : 1, NULL, NULL);
+        if (seq == 0 || !cpu1_wait(seq, 100000)) {
+            printf("swap: %d timed out\n", i);
+            return false;
+        }
+        uint32_t cycles = seq_ccount() - start;
+        min = cycles < min ? cycles : min;
+        max = cycles > max ? cycles : max;
+        total += cycles;
+        drained += sim_events(events, BENCH_EVENTS);
+    }
+    uint32_t cycles_per_us = SIM_CPU_HZ / 1000000;
+    printf("swap: %u pages, %d swaps, %" PRIu32 "/%" PRIu32 "/%" PRIu32
+           " us min/avg/max\n",
+           (unsigned)count, BENCH_SWAPS, min / cycles_per_us,
+           (uint32_t)(total / BENCH_SWAPS / cycles_per_us),
+           max / cycles_per_us);
+    return set_active_bank(0xFF);
+}
+
+// The stop only lands once the paced cycle ends, so deinit_gpios() has to
+// wait for the whole of it.
+static bool bench_slow_stop() {
+    size_t words = rle_encode((const uint32_t *)flat, BENCH_PAGES, prog,
+                              sizeof(prog) / sizeof(prog[0]) - 1);
+    if (words != 0) {
+        prog[words++] = RLE_WORD(RLE_OP_EOP, 0);
+    }
+    if (words == 0 || !init_gpios_rle(2, words, PATTERN_MEM_DRAM) ||
+        !write_rle_bank(0, prog, words) || !set_active_bank(0) ||
+        !set_pacing(BENCH_SLOW_PACE)) {
+        printf("slow stop: setup failed\n");
+        return false;
+    }
+    // Answered between the same long cycles.
+    cpu1_stats_t st;
+    if (!cpu1_read_stats(&st) || st.pace_cycles != BENCH_SLOW_PACE) {
+        printf("slow stop: stats not read\n");
+        return false;
+    }
+    int64_t wait = cpu1_cycle_wait_us();
+    int64_t t0 = seq_time_us();
+    bool ok = deinit_gpios();
+    printf("slow stop: %" PRId64 " us allowed, took %" PRId64 " us\n", wait,
+           seq_time_us() - t0);
+    return set_pacing(0) && ok;
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "m:")) != -1) {
+        if (opt == 'm') {
+            bench_ms = strtoul(optarg, NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-m ms]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!sim_init(BENCH_EVENTS)) {
+        return 1;
+    }
+
+    bool ok = true;
+    make_pattern(BENCH_PAGES, 1);
+    ok = ok && bench_flat("toggle", BENCH_PAGES);
+    ok = ok && bench_rle("toggle", BENCH_PAGES, 1);
+
+    make_pattern(BENCH_PAGES, 8);
+    ok = ok && bench_flat("runs of 8", BENCH_PAGES);
+    ok = ok && bench_rle("runs of 8", BENCH_PAGES, 1);
+    ok = ok && bench_rle("runs of 8 looped", BENCH_PAGES, BENCH_LONG_LOOPS);
+
+    ok = ok && bench_swaps(BENCH_PAGES);
+    ok = ok && bench_swaps(8);
+    ok = ok && bench_slow_stop();
+
+    printf("%" PRIu32 " pages recorded, %" PRIu32 " dropped\n", drained,
+           sim_dropped());
+    return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,246 @@
+// Host only, not part of the firmware build; see sequencer-port-sim.h.
+//
+//   sequencer-stress [-m ms]
+//
+// Hammers the PRO cpu side of the mailbox for 2000ms or -m while the APP cpu
+// thread plays unpaced, then checks every page it wrote. Each page carries
+// its bank, a version and its index:
+//
+//   set   = bank << 30 | version << 8 | index
+//   clear = ~set
+//
+// and whole banks move to a new version at once, through patch_pages() from
+// a strided buffer (the shadow pool), through cpu1_submit() as a batch of
+// two half bank patches (mailbox batches), and with request_bank() swapping
+// banks in between. Patches and swaps only land between page cycles, so a
+// page whose clear isn't ~set, or a cycle mixing versions or banks, is a
+// torn write, and a bank's version going backwards is a reordered one.
+#ifdef SEQUENCER_HOST
+#include <pthread.h>
+
+#include "inttypes.h"
+#include "sequencer-core.h"
+#include "stdlib.h"
+#include "unistd.h"
+
+#define STRESS_PAGES 32
+#define STRESS_EVENTS (1 << 20)
+#define STRESS_SWAP_EVERY 7
+#define VERSION_MASK 0x3FFFFF
+
+#define PAGE_BANK(X) ((X) >> 30)
+#define PAGE_VERSION(X) (((X) >> 8) & VERSION_MASK)
+#define PAGE_INDEX(X) ((X)&0xFF)
+
+typedef struct checker {
+    volatile bool stop;
+    uint32_t pages;
+    uint32_t cycles;
+    uint32_t errors;
+    uint32_t version[2];
+    sim_event_t last;
+    bool started;
+} checker_t;
+
+static checker_t check = {0};
+static sim_event_t events[4096];
+
+static uint32_t page_set(uint8_t bank, uint32_t version, uint8_t i) {
+    return (uint32_t)bank << 30 | (version & VERSION_MASK) << 8 | i;
+}
+
+static void report(const sim_event_t *ev, const char *what) {
+    if (check.errors++ < 10) {
+        printf("page %" PRIu32 ": set %08" PRIx32 " clear %08" PRIx32
+               " after %08" PRIx32 ": %s\n",
+               check.pages, ev->set, ev->clear, check.last.set, what);
+    }
+}
+
+static void check_page(const sim_event_t *ev) {
+    uint32_t bank = PAGE_BANK(ev->set);
+    uint32_t version = PAGE_VERSION(ev->set);
+    uint32_t i = PAGE_INDEX(ev->set);
+
+    if (ev->clear != ~ev->set || bank > 1 || i >= STRESS_PAGES) {
+        report(ev, "torn page");
+    } else if (i == 0) {
+        if (check.started && PAGE_INDEX(check.last.set) != STRESS_PAGES - 1) {
+            report(ev, "cycle cut short");
+        }
+        if (version < check.version[bank]) {
+            report(ev, "version went backwards");
+        }
+        check.version[bank] = version;
+        check.cycles++;
+    } else if (!check.started || i != PAGE_INDEX(check.last.set) + 1) {
+        report(ev, "page out of order");
+    } else if ((ev->set & ~0xFFU) != (check.last.set & ~0xFFU)) {
+        report(ev, "torn cycle");
+    }
+    check.last = *ev;
+    check.started = true;
+    check.pages++;
+}
+
+static void *checker_main(void *arg) {
+    while (true) {
+        bool stop = check.stop;
+        size_t n = sim_events(events, sizeof(events) / sizeof(events[0]));
+        for (size_t i = 0; i < n; i++) {
+            check_page(&events[i]);
+        }
+        if (n == 0 && stop) {
+            return NULL;
+        } else if (n == 0) {
+            seq_spin();
+        }
+    }
+}
+
+// Retries while the mailbox or shadow pool is full.
+static uint32_t retry_patch(uint8_t bank, const uint32_t *src,
+                            uint8_t stride) {
+    for (int tries = 0; tries < 100000; tries++) {
+        uint32_t seq = patch_pages(bank, 0, STRESS_PAGES, PATCH_PAGE,
+                                   src, stride, NULL, NULL);
+        if (seq != 0) {
+            return seq;
+        }
+        seq_spin();
+    }
+    return 0;
+}
+
+static uint32_t retry_submit(const cpu1_cmd_t *cmds, size_t count) {
+    for (int tries = 0; tries < 100000; tries++) {
+        uint32_t seq = cpu1_submit(cmds, count, NULL, NULL);
+        if (seq != 0) {
+            return seq;
+        }
+        seq_spin();
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    uint32_t ms = 2000;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:")) != -1) {
+        if (opt == 'm') {
+            ms = strtoul(optarg, NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-m ms]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    uint32_t set[STRESS_PAGES];
+    uint32_t clear[STRESS_PAGES];
+    if (!sim_init(STRESS_EVENTS) || !init_gpios(2, STRESS_PAGES)) {
+        return 1;
+    }
+    for (uint8_t bank = 0; bank < 2; bank++) {
+        for (uint8_t i = 0; i < STRESS_PAGES; i++) {
+            set[i] = page_set(bank, 0, i);
+            clear[i] = ~set[i];
+        }
+        if (!write_set_bank(bank, 0, STRESS_PAGES, set) ||
+            !write_clear_bank(bank, 0, STRESS_PAGES, clear)) {
+            return 1;
+        }
+    }
+
+    pthread_t checker;
+    if (pthread_create(&checker, NULL, checker_main, NULL) != 0 ||
+        !set_active_bank(0)) {
+        return 1;
+    }
+
+    // Strided for patch_pages(): set, clear and a word it must skip.
+    uint32_t strided[STRESS_PAGES * 3];
+    // Packed for cpu1_submit(), which reads it on the APP cpu, so it is only
+    // rewritten once the batch has been applied.
+    uint32_t packed[STRESS_PAGES * 2];
+    uint32_t version[2] = {0, 0};
+    uint32_t patches = 0;
+    uint32_t batches = 0;
+    uint32_t swaps = 0;
+    uint8_t bank = 0;
+    bool ok = true;
+    int64_t end = seq_time_us() + (int64_t)ms * 1000;
+    for (uint32_t n = 0; ok && seq_time_us() < end; n++) {
+        uint8_t target = rand() & 1;
+        uint32_t v = ++version[target];
+        if (n & 1) {
+            for (uint8_t i = 0; i < STRESS_PAGES; i++) {
+                strided[i * 3] = page_set(target, v, i);
+                strided[i * 3 + 1] = ~strided[i * 3];
+                strided[i * 3 + 2] = 0xDEADBEEF;
+            }
+            ok = retry_patch(target, strided, 3) != 0;
+            patches++;
+        } else {
+            for (uint8_t i = 0; i < STRESS_PAGES; i++) {
+                packed[i * 2] = page_set(target, v, i);
+                packed[i * 2 + 1] = ~packed[i * 2];
+            }
+            uint8_t half = STRESS_PAGES / 2;
+            cpu1_cmd_t cmds[2] = {
+                {.op = CPU1_PATCH_PAGES,
+                 .bank = target,
+                 .offset = 0,
+                 .len = half,
+                 .fields = PATCH_PAGE,
+                 .src = packed},
+                {.op = CPU1_PATCH_PAGES,
+                 .bank = target,
+                 .offset = half,
+                 .len = STRESS_PAGES - half,
+                 .fields = PATCH_PAGE,
+                 .src = packed + half * 2},
+            };
+            uint32_t seq = retry_submit(cmds, 2);
+            ok = seq != 0 && cpu1_wait(seq, 100000);
+            batches++;
+        }
+        if (ok && n % STRESS_SWAP_EVERY == 0) {
+            bank ^= 1;
+            ok = retry_submit(&(cpu1_cmd_t){.op = CPU1_SWAP_BANK,
+                                            .bank = bank},
+                              1) != 0;
+            swaps++;
+        }
+    }
+    if (!ok) {
+        printf("PRO cpu side failed after %" PRIu32 " patches\n",
+               patches + batches);
+    }
+    ok = set_active_bank(0xFF) && ok;
+
+    // Outputs are released by the FROM_CPU_INTR2 handler once the stop is
+    // acked, which is a moment after cpu1_wait() sees it applied.
+    int64_t deadline = seq_time_us() + 100000;
+    while (mailbox.resp_tail != mailbox.cmd_head &&
+           seq_time_us() < deadline) {
+        seq_spin();
+    }
+    if (sim_enabled() != 0) {
+        printf("outputs %08" PRIx32 " still enabled\n", sim_enabled());
+        ok = false;
+    }
+
+    check.stop = true;
+    pthread_join(checker, NULL);
+    printf("%" PRIu32 " patches, %" PRIu32 " batches, %" PRIu32
+           " swaps; %" PRIu32 " pages in %" PRIu32 " cycles, %" PRIu32
+           " dropped, %" PRIu32 " errors\n",
+           patches, batches, swaps, check.pages, check.cycles, sim_dropped(),
+           check.errors);
+    if (sim_dropped() != 0) {
+        printf("checker fell behind, dropped pages break the checks\n");
+        ok = false;
+    }
+    return ok && check.errors == 0 && check.cycles > 0 ? 0 : 1;
+}
+#endif
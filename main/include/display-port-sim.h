@@ -0,0 +1,91 @@
+#pragma once
+#include "esp32-cpu1.h"
+#include "fluke8050.h"
+#include "lvgl/lvgl.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+
+// Host stand-ins for the display code. main/host/CMakeLists.txt builds
+// them into render-harness with the screens and LVGL v7's sources, with
+// -DDISPLAY_HOST -DSEQUENCER_HOST -DLV_CONF_INCLUDE_SIMPLE and main/host on
+// the include path for its lv_conf.h. Nothing here needs SDL or a GPU: the
+// panel is a frame in memory.
+//
+// There is one thread. display_host_step() is a pass of the display task's
+// loop and the harness plays the bus task in between. The diagnostics
+// screen reads the APP cpu and is left out.
+//
+// Time is simulated: esp_timer_get_time() only moves with sim_advance_us(),
+// so a run draws the same pixels every time.
+#define CONFIG_LV_DISPLAY_WIDTH 240
+#define CONFIG_LV_DISPLAY_HEIGHT 135
+
+int64_t esp_timer_get_time();
+void sim_advance_us(int64_t us);
+
+#define ESP_LOGE(tag, fmt, ...) printf("E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) printf("W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) printf("I %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...)         \
+    do {                                \
+        if (0) {                        \
+            printf(fmt, ##__VA_ARGS__); \
+        }                               \
+    } while (0)
+
+// The derived reading's cycle counts read 0.
+#define XTHAL_GET_CCOUNT() 0
+
+// A heap that never runs short. Screen build costs only count LVGL's pool.
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define SIM_HEAP_FREE (256 * 1024)
+
+static inline void *heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+static inline size_t heap_caps_get_free_size(uint32_t caps) {
+    return SIM_HEAP_FREE;
+}
+static inline size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return SIM_HEAP_FREE;
+}
+static inline size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    return SIM_HEAP_FREE;
+}
+
+// FreeRTOS, for one thread. Nothing blocks: queues return at once and the
+// task the display code notifies is the caller itself.
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef struct sim_queue *QueueHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY UINT32_MAX
+#define portTICK_PERIOD_MS 10
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms) / portTICK_PERIOD_MS)
+
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size);
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait);
+#define xTaskNotifyGive(task) ((void)(task))
+// Only the display code's fatal errors wait forever.
+#define vTaskDelay(ticks) abort()
+
+// The panel: CONFIG_LV_DISPLAY_WIDTH by CONFIG_LV_DISPLAY_HEIGHT pixels in
+// memory, row by row, which sim_display_flush() copies areas into the way
+// st7789_flush() sends them.
+void sim_display_flush(lv_disp_drv_t *drv, const lv_area_t *area,
+                       lv_color_t *color_map);
+const lv_color_t *sim_framebuffer();
+
+// The bus: what the screens read through fluke8050-bus.h. Set the meter
+// count before display_host_start(); sim_bus_publish() numbers and stamps
+// the reading and files it in the history like the bus task does.
+void sim_bus_set_meters(uint8_t meters);
+void sim_bus_publish(uint8_t meter, fluke8050_reading_t *r);
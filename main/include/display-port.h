@@ -0,0 +1,16 @@
+#pragma once
+
+// What the display code needs from ESP-IDF and FreeRTOS. With DISPLAY_HOST
+// defined it comes from display-port-sim.h instead, so the screens can be
+// rendered on a host.
+#ifdef DISPLAY_HOST
+#include "display-port-sim.h"
+#else
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "xtensa/core-macros.h"
+#endif
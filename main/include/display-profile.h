@@ -0,0 +1,50 @@
+#pragma once
+
+#include "stddef.h"
+#include "stdint.h"
+
+// Per-frame profile of the GUI on CPU0. screen-core records a frame for
+// every refresh that drew something, keeping the last PROFILE_FRAMES.
+#define PROFILE_FRAMES 64
+
+typedef struct frame_profile {
+    uint32_t end_ms;      // esp_timer time the refresh finished
+    uint32_t frame_us;    // The refresh: rendering, flush calls and stalls
+    uint32_t flush_us;    // Of that, in st7789_flush()
+    uint32_t wait_us;     // Of that, stalled on a transfer
+    uint32_t tick_us;     // In screen tick_cbs since the previous frame
+    uint32_t handler_us;  // lv_task_handler() or display_wake() update
+                          // the frame was drawn in, everything included
+    uint32_t px;          // Pixels redrawn
+    uint16_t invalidations;  // Areas invalidated since the previous frame
+    uint16_t areas;          // Flushes
+} frame_profile_t;
+
+typedef struct profile_summary {
+    uint32_t frames;
+    uint32_t fps_x10;
+    uint32_t frame_avg_us;
+    uint32_t frame_max_us;
+    uint32_t flush_avg_us;
+    uint32_t wait_avg_us;
+    uint32_t tick_avg_us;
+    uint32_t handler_avg_us;
+    uint32_t px_avg;
+} profile_summary_t;
+
+// Display task only.
+void profile_record(const frame_profile_t *frame);
+// Sets handler_us on the frames recorded since the last call.
+void profile_handler_done(uint32_t us);
+// Oldest first, at most max. Returns the number copied.
+size_t profile_copy(frame_profile_t *out, size_t max);
+void profile_summarize(profile_summary_t *out);
+// Every frame in the ring and the summary, on the console.
+void profile_dump();
+
+// Overlay on the top layer, so it shows over whichever screen is up. It
+// redraws once a second, which shows up in its own numbers. Safe from any
+// task; the display task applies it and dumps the ring each time.
+void profile_toggle();
+// Display task only, from the content worker.
+void profile_overlay_update();
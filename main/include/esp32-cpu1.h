@@ -13,16 +13,256 @@
 // limitations under the License.
 #pragma once
 #include "inttypes.h"
-#include "soc/dport_reg.h"
+#include "stddef.h"
+#include "sequencer-port.h"
 #include "stdbool.h"
 
+#ifndef BIT
+#define BIT(X) (1 << X)
+#endif
+
 extern volatile DRAM_ATTR uint32_t cpu1_counter;
 
+// One step of a pattern: the GPIO.out_w1ts and GPIO.out_w1tc values.
+typedef struct gpio_page {
+    uint32_t set;
+    uint32_t clear;
+} gpio_page_t;
+
+// A page for timed playback. The set/clear values are written when the
+// page's deadline is reached, and the next page follows cycles CPU cycles
+// later.
+typedef struct timed_page {
+    uint32_t set;
+    uint32_t clear;
+    uint32_t cycles;
+    uint32_t reserved;
+} timed_page_t;
+
+// How the arena's banks are laid out and played.
+typedef enum pattern_format {
+    PATTERN_FLAT,   // gpio_page_t, init_gpios()/init_gpios_in()
+    PATTERN_TIMED,  // timed_page_t, init_gpios_timed()
+    PATTERN_RLE     // pattern-rle.h programs, init_gpios_rle()
+} pattern_format_t;
+
+// Shortest page the timed loop can hold to at 240MHz without going late.
+#define TIMED_PAGE_MIN_CYCLES 32
+
+#define PATTERN_ARENA_ALIGN 8
+
+// Where the pattern arena lives. IRAM is shared by both CPUs and keeps small
+// patterns out of the DRAM heap. RTC fast memory is not offered: on the
+// ESP32 only the PRO cpu can reach it.
+typedef enum pattern_mem {
+    PATTERN_MEM_DRAM,
+    PATTERN_MEM_IRAM
+} pattern_mem_t;
+
+// Input capture. The APP cpu samples GPIO.in/GPIO.in1 between pages (or
+// continuously when no bank is active) into a ring that FreeRTOS tasks on
+// the PRO cpu drain in batches.
+typedef enum capture_mode {
+    CAPTURE_PERIODIC,  // One sample every period_cycles
+    CAPTURE_EDGE       // One sample whenever a trigger pin changes
+} capture_mode_t;
+
+typedef struct capture_config {
+    capture_mode_t mode;
+    uint32_t in_mask;     // GPIO0-31 to keep in each sample
+    uint32_t in1_mask;    // GPIO32-39 to keep, bit 0 is GPIO32
+    uint32_t trig_mask;   // CAPTURE_EDGE: GPIO0-31 that trigger a sample
+    uint32_t trig1_mask;  // CAPTURE_EDGE: GPIO32-39 that trigger a sample
+    uint32_t period_cycles;
+    uint32_t samples;  // Ring size, must be a power of two
+} capture_config_t;
+
+typedef struct capture_sample {
+    uint32_t in;
+    uint8_t in1;
+    uint8_t reserved;
+    uint16_t dt;  // CPU cycles since the previous sample, saturating
+} capture_sample_t;
+
+typedef struct capture_stats {
+    uint32_t samples;    // Taken since capture_start(), including dropped
+    uint32_t overflows;  // Dropped because the ring was full
+    uint32_t pending;    // Waiting to be drained
+} capture_stats_t;
+
+// Command mailbox to the APP cpu. Commands are queued without blocking and
+// applied by the APP cpu between page cycles. A batch handed to
+// cpu1_submit() is applied as a whole, so the output never shows half of it.
+#define CPU1_MAILBOX_SIZE 16
+
+typedef enum cpu1_op {
+    CPU1_SWAP_BANK,      // bank, 0xFF stops output
+    CPU1_PATCH_PAGES,    // bank, offset, len, fields, src
+    CPU1_SET_PACING,     // pace_cycles, untimed banks only. 0 runs free.
+    CPU1_CAPTURE_START,  // Ring and config set up by capture_start()
+    CPU1_CAPTURE_STOP,
+    CPU1_READ_STATS,  // stats, copied between page cycles so it is consistent
+    CPU1_RESET_STATS
+} cpu1_op_t;
+
+// Which words of each page a patch replaces.
+typedef enum patch_fields {
+    PATCH_SET = BIT(0),
+    PATCH_CLEAR = BIT(1),
+    PATCH_CYCLES = BIT(2),  // Timed banks only
+    PATCH_PAGE = PATCH_SET | PATCH_CLEAR,
+    PATCH_TIMED_PAGE = PATCH_SET | PATCH_CLEAR | PATCH_CYCLES
+} patch_fields_t;
+
+typedef enum cpu1_status {
+    CPU1_OK = 0,
+    CPU1_EINVAL
+} cpu1_status_t;
+
+// Page period histogram: bucket i counts periods of [8 << i, 16 << i) CPU
+// cycles. Bucket 0 also takes anything shorter and the last bucket anything
+// longer.
+#define CPU1_HIST_BUCKETS 16
+#define CPU1_HIST_SHIFT 3
+
+typedef struct cpu1_stats {
+    uint32_t pages;  // Pages emitted, same as cpu1_counter
+    uint8_t active_bank;
+    uint32_t pace_cycles;
+    uint32_t timed_worst_jitter;
+    uint32_t timed_late_pages;
+    uint32_t capture_samples;
+    uint32_t capture_overflows;
+    uint32_t wakeups;
+
+    // Cycles between consecutive page writes while a bank plays, since the
+    // last CPU1_RESET_STATS. A stall is a period of at least twice what the
+    // page asked for: the pacing, the timed page length, or the shortest
+    // period seen when running free.
+    uint32_t period_hist[CPU1_HIST_BUCKETS];
+    uint32_t period_min;
+    uint32_t period_max;
+    uint64_t period_total;
+    uint32_t periods;
+    uint32_t stalls;
+    uint32_t bank_switches;
+} cpu1_stats_t;
+
+typedef struct cpu1_cmd {
+    cpu1_op_t op;
+    uint8_t bank;
+    uint8_t offset;
+    uint8_t len;
+    uint8_t fields;
+    union {
+        // For each of len pages, one word per selected field in set, clear,
+        // cycles order. Must stay valid until the command completes; use
+        // patch_pages() to have it copied into a shadow buffer instead.
+        const uint32_t *src;
+        uint32_t pace_cycles;
+        // Written by the APP cpu whenever the command is applied, so like
+        // src it must stay valid until then.
+        cpu1_stats_t *stats;
+    };
+} cpu1_cmd_t;
+
+// Called from the FROM_CPU_INTR2 handler on the PRO cpu when the last
+// command of a batch completes. status is the first error in the batch.
+// Must live in IRAM.
+typedef void (*cpu1_done_cb_t)(uint32_t seq, cpu1_status_t status, void *arg);
+
+// Queue count commands as one batch. Returns the sequence number of the last
+// command, or 0 if the mailbox is full or a command is invalid. cb may be
+// NULL.
+uint32_t cpu1_submit(const cpu1_cmd_t *cmds, size_t count, cpu1_done_cb_t cb,
+                     void *arg);
+bool cpu1_done(uint32_t seq);
+// Busy-waits, the APP cpu answers within a page cycle.
+bool cpu1_wait(uint32_t seq, int64_t timeout_us);
+// How long a command can take to be applied: a whole page cycle of the bank
+// playing or asked for, at the slower of the last two pacings, plus
+// CPU1_WAIT_SLACK_US for waking the APP cpu. RLE cycles can run for
+// seconds. The blocking calls below wait this long.
+#define CPU1_WAIT_SLACK_US 10000
+int64_t cpu1_cycle_wait_us();
+// CPU1_READ_STATS into a snapshot esp32-cpu1.c owns. cpu1_request_stats()
+// queues a read unless one is still in flight; cpu1_fetch_stats() copies the
+// snapshot out once the latest read has been applied and is false until
+// then. cpu1_read_stats() does both, waiting cpu1_cycle_wait_us(). For one
+// task at a time.
+bool cpu1_request_stats();
+bool cpu1_fetch_stats(cpu1_stats_t *stats);
+bool cpu1_read_stats(cpu1_stats_t *stats);
+// One line summary plus the period histogram, on the console.
+void cpu1_print_stats(const cpu1_stats_t *stats);
+
+// Queue a switch to bank (0xFF stops output) without blocking. The APP cpu
+// picks it up at the end of the current page cycle. Returns the command
+// sequence number, or 0 on error.
+uint32_t request_bank(uint8_t bank, cpu1_done_cb_t cb, void *arg);
+// Request to ack latency in PRO cpu cycles, last switch and worst seen.
+void get_bank_switch_latency(uint32_t *last_cycles, uint32_t *max_cycles);
+
+// The APP cpu gates its own clock when no bank is active and capture is
+// off. cpu1_submit() wakes it; wake_app_cpu() is safe to call from
+// anywhere, including ISRs. Latency is from ungating the clock to the APP
+// cpu's ack interrupt, in PRO cpu cycles.
+void wake_app_cpu();
+void get_app_cpu_wake_latency(uint32_t *last_cycles, uint32_t *max_cycles);
+
+// Stage a patch of any bank, including the one being played, in a shadow
+// buffer and have the APP cpu commit it at the next cycle boundary. src
+// holds len elements stride words apart; the selected fields are read in
+// set, clear, cycles order from the start of each element, so a gpio_page_t
+// array is stride 2, a timed_page_t array stride 4 and a plain uint32_t
+// array stride 1. Returns the command sequence number, or 0 if the shadow
+// pool or mailbox is full.
+uint32_t patch_pages(uint8_t bank, uint8_t offset, uint8_t len,
+                     patch_fields_t fields, const uint32_t *src,
+                     uint8_t stride, cpu1_done_cb_t cb, void *arg);
+
+// Blocking wrapper around request_bank(), waits cpu1_cycle_wait_us().
 bool set_active_bank(uint8_t bank);
+// Blocking CPU1_SET_PACING, waits cpu1_cycle_wait_us().
+bool set_pacing(uint32_t pace_cycles);
+// Writes to a bank that is playing, or about to, go through patch_pages()
+// and land at the next cycle boundary; other banks are written directly.
 bool write_set_bank(uint8_t bank, uint8_t offset, uint8_t len,
                     uint32_t *values);
 bool write_clear_bank(uint8_t bank, uint8_t offset, uint8_t len,
                       uint32_t *values);
 
 bool init_gpios(uint8_t new_banks, uint8_t new_pages);
-void deinit_gpios();
\ No newline at end of file
+bool init_gpios_in(uint8_t new_banks, uint8_t new_pages, pattern_mem_t mem);
+
+// Timed playback: pages are timed_page_t and the APP cpu paces them against
+// CCOUNT. write_set_bank()/write_clear_bank() still work on timed banks.
+bool init_gpios_timed(uint8_t new_banks, uint8_t new_pages,
+                      pattern_mem_t mem);
+bool write_timed_bank(uint8_t bank, uint8_t offset, uint8_t len,
+                      const timed_page_t *values);
+// Worst lateness of any page write against its deadline, in CPU cycles, and
+// the number of pages that were late by a whole page.
+void get_timed_jitter(uint32_t *worst_cycles, uint32_t *late_pages);
+void reset_timed_jitter();
+
+// Run-length playback: each bank holds a pattern-rle.h program of up to
+// words_per_bank words, decoded by the APP cpu as it plays, so one cycle
+// can run far past 255 pages without expanding repeats in memory. Pacing
+// from CPU1_SET_PACING applies as for flat banks. Commands are applied at
+// RLE_OP_EOP, so a long cycle delays bank swaps by as much. Banks can't be
+// patched; write_rle_bank() replaces a whole program and only works on a
+// bank that is not playing or about to.
+bool init_gpios_rle(uint8_t new_banks, uint16_t words_per_bank,
+                    pattern_mem_t mem);
+bool write_rle_bank(uint8_t bank, const uint32_t *prog, uint16_t words);
+
+bool capture_start(const capture_config_t *cfg);
+// Waits cpu1_cycle_wait_us(). On a timeout the ring is kept and the stop
+// stays queued; calling again waits for that same stop.
+bool capture_stop();
+size_t capture_drain(capture_sample_t *out, size_t max);
+// Counters only; rates are left to whoever drains, see fluke8050-bus.c.
+void capture_get_stats(capture_stats_t *stats);
+// False, with the arena kept, if the APP cpu didn't stop playing in time.
+bool deinit_gpios();
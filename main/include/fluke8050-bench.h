@@ -0,0 +1,19 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+// Decodes synthetic interleaved scans from 1 to FLUKE8050_MAX_METERS meters
+// the way the bus task does and logs cycles per sample and the scans/s
+// ceiling of the decode alone. Needs no meters attached.
+void fluke8050_decode_benchmark();
@@ -0,0 +1,110 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "fluke8050.h"
+#include "reading-history.h"
+#include "stdbool.h"
+#include "stdint.h"
+
+// Live decode of 8050A display buses: the APP cpu samples every meter's
+// pins in one capture, a task on the PRO cpu drains the samples, runs each
+// meter's decoder over them and keeps each meter's latest complete reading.
+//
+// Throughput limits, worked out from the ring size and the tick rather
+// than measured. The APP cpu's sampling loop reads GPIO.in/in1 once per pass
+// whatever the meter count, so the capture ring's sample rate is the sum
+// of the meters' edge rates. A scan is 7 strobes, 14 edges, plus up to 4
+// data changes per latch: 14 to 42 samples. The bus task drains the ring
+// once a tick, so with a 1024 sample ring and a 100Hz tick the ring can
+// take at most 102400 samples/s before overflowing, i.e. per meter at
+// worst:
+//
+//   meters  samples/s each  scans/s each
+//   1       102400          2400
+//   2       51200           1200
+//   3       34100           800
+//   4       25600           600
+//
+// These are ceilings; the sampling loop's own rate and the task's latency
+// past its tick can only lower them. Raise samples to move the ceiling.
+// What a running bus actually achieves is measured by the bus task and
+// reported as sample_rate and scan_rate by fluke8050_bus_get_stats().
+// Decoding costs a compare per sample per meter plus the full decode for
+// the meter whose pins moved; build with FLUKE8050_DECODE_BENCHMARK to
+// measure that for 1 to 4 synthetic meters on the target. No measured
+// figures are given here: this board wires one meter (see below), and the
+// multi-meter rows need a board with the inputs for more.
+//
+// Meters. FLUKE8050_MAX_METERS is what the bus task and decoders handle,
+// not what this board can wire: each meter needs 11 GPIOs of its own, and
+// after the display, the buttons, the sequencer's outputs and the console
+// UART the board has 16 left, enough for one meter. More need a board with
+// more free inputs.
+#define FLUKE8050_MAX_METERS 4
+
+typedef struct fluke8050_meter_config {
+    uint8_t strobe_pins[FLUKE8050_STROBES];  // fluke8050_latch_t order
+    uint8_t data_pins[4];                    // BCD bit 0 first
+} fluke8050_meter_config_t;
+
+typedef struct fluke8050_bus_config {
+    uint8_t meters;
+    fluke8050_meter_config_t meter[FLUKE8050_MAX_METERS];
+    uint32_t max_gap_us;  // 0 disables the gap check
+    uint32_t samples;     // Capture ring shared by all meters, power of two
+} fluke8050_bus_config_t;
+
+// Numeric readings kept by the bus task, 8 bytes each, in .bss. Shared
+// evenly by the meters.
+#define FLUKE8050_HISTORY_SAMPLES 4096
+
+// One meter. GPIO25/26 stay free for the sequencer's outputs.
+#define FLUKE8050_BUS_DEFAULT_CONFIG                               \
+    {                                                              \
+        .meters = 1,                                               \
+        .meter = {{.strobe_pins = {13, 17, 21, 22, 27, 32, 33},    \
+                   .data_pins = {36, 37, 38, 39}}},                \
+        .max_gap_us = 0,                                           \
+        .samples = 1024,                                           \
+    }
+
+typedef struct fluke8050_bus_stats {
+    uint32_t readings;   // Complete scans published
+    uint32_t torn;       // Scans dropped by the decoder
+    uint32_t overflows;  // Capture samples lost to a full ring, all meters
+    // Measured by the bus task over the last second.
+    uint32_t sample_rate;  // Capture samples/s, all meters
+    uint32_t scan_rate;    // This meter's readings/s
+} fluke8050_bus_stats_t;
+
+bool fluke8050_bus_start(const fluke8050_bus_config_t *cfg);
+// Meters running, 0 before fluke8050_bus_start().
+uint8_t fluke8050_bus_meters();
+// Latest complete reading, false until there is one.
+bool fluke8050_bus_latest(uint8_t meter, fluke8050_reading_t *out);
+void fluke8050_bus_get_stats(uint8_t meter, fluke8050_bus_stats_t *stats);
+// cb runs on the bus task after each batch of samples that gave any meter
+// a new reading.
+void fluke8050_bus_set_listener(void (*cb)(void *arg), void *arg);
+
+// Every reading that shows a number goes into its meter's history as
+// fluke8050_reading_value(), whichever screen is up. These take a lock
+// shared with the bus task, so copy in small batches.
+void fluke8050_bus_history_stats(uint8_t meter, history_stats_t *stats);
+void fluke8050_bus_history_span(uint8_t meter, uint32_t *first,
+                                uint32_t *total);
+size_t fluke8050_bus_history_copy(uint8_t meter, uint32_t from,
+                                  history_sample_t *out, size_t max,
+                                  uint32_t *next);
+void fluke8050_bus_history_reset(uint8_t meter);
@@ -0,0 +1,83 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "esp32-cpu1.h"
+#include "fluke8050.h"
+
+// Turns CAPTURE_EDGE samples of the 8050A display bus into readings. Capture
+// should trigger on the strobes and the data lines, so every strobe edge and
+// every data change under a strobe gives a sample. A latch takes the data
+// present when its strobe falls, as the CD4056 does.
+//
+// A scan must strobe every latch exactly once, in fluke8050_latch_t order.
+// Anything else is a torn frame and is dropped: overlapping strobes, a latch
+// out of order, or a gap longer than max_gap_cycles in the middle of a scan.
+// A scan boundary is the first latch's strobe, or such a gap.
+//
+// Several meters can share one capture: each decoder only looks at its own
+// pins, so a sample where none of them changed costs one compare, and gaps
+// are measured from the meter's own last change.
+//
+// Needs nothing from ESP-IDF beyond capture_sample_t, so it builds on the
+// host with SEQUENCER_HOST.
+typedef struct fluke8050_decoder {
+    // Set up by fluke8050_decoder_init()
+    uint32_t strobe_in[FLUKE8050_STROBES];   // GPIO0-31 mask per latch
+    uint8_t strobe_in1[FLUKE8050_STROBES];   // GPIO32-39 mask per latch
+    uint8_t data_lut[256];                   // in1 byte to BCD nibble
+    uint32_t data_in[4];                     // Data pins on GPIO0-31
+    uint32_t in_mask;                        // All of this meter's pins
+    uint8_t in1_mask;
+    uint32_t max_gap_cycles;                 // 0 disables the gap check
+
+    uint8_t active;  // Latch whose strobe is high, FLUKE8050_STROBES if none
+    uint8_t data;    // Bus value while it is
+    uint8_t next;    // Latch the scan expects next
+    uint8_t nibbles[FLUKE8050_STROBES];
+    uint32_t last_in;  // This meter's pins at the last sample that moved them
+    uint8_t last_in1;
+
+    uint64_t cycles;      // Sum of sample dt, saturated gaps included
+    uint64_t end_cycles;  // cycles at the last completed scan
+    uint64_t change_cycles;  // cycles when this meter's pins last changed
+
+    uint32_t frames;
+    uint32_t torn;
+} fluke8050_decoder_t;
+
+// data_pins are BCD bit 0 first; strobe_pins are in fluke8050_latch_t order.
+// Data on GPIO32-39 decodes with one lookup, elsewhere with a test per bit.
+bool fluke8050_decoder_init(fluke8050_decoder_t *d,
+                            const uint8_t strobe_pins[FLUKE8050_STROBES],
+                            const uint8_t data_pins[4],
+                            uint32_t max_gap_cycles);
+// Adds the capture masks that make the sampler see everything the decoder
+// needs to cfg, so one capture can serve several decoders.
+void fluke8050_decoder_capture(const fluke8050_decoder_t *d,
+                               capture_config_t *cfg);
+// Feeds one sample. Returns true when it completes a scan, with out filled
+// in apart from seq and time_us; d->end_cycles marks when.
+bool fluke8050_decode(fluke8050_decoder_t *d, const capture_sample_t *s,
+                      fluke8050_reading_t *out);
+
+// Readings as numbers, in 1/FLUKE8050_VALUE_SCALE of the displayed unit so
+// every range fits an int32_t: 1.9999 is 19999 and 19999. is 199990000.
+#define FLUKE8050_VALUE_SCALE 10000
+
+// False when the display doesn't show a number: a digit is one of the
+// letters, a dash or blank.
+bool fluke8050_reading_value(const fluke8050_reading_t *r, int32_t *value);
+// A value as the displayed unit with all four decimals, "-12.3450", using
+// integer division only. Returns what snprintf() does.
+int fluke8050_format_value(int32_t value, char *buf, size_t len);
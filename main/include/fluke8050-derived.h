@@ -0,0 +1,70 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+// Derived readings worked out from each fluke8050_reading_value(), in the
+// same 1/FLUKE8050_VALUE_SCALE units: dB results are in 1/10000 dB.
+//
+// Everything per reading is integer. dB goes through a base 2 logarithm
+// from a 256 entry table with linear interpolation, good to 0.001 dB;
+// the table and the dBm offsets are built once by derived_init().
+//
+// The bus only carries the digits and the decimal point, which sit the same
+// on the 200mV and 200V ranges, so dB needs the unit from the user: until
+// one is picked the dB modes have no result.
+//
+// Needs nothing from ESP-IDF, so it builds on the host.
+typedef enum derived_mode {
+    DERIVED_OFF,
+    DERIVED_REL,    // Reading less the reference taken when selected
+    DERIVED_DBV,    // 20 log10(|V| / 1V)
+    DERIVED_DBM,    // Power into the selected impedance, against 1mW
+    DERIVED_SCALE,  // Reading times the selected ratio
+    DERIVED_MODES
+} derived_mode_t;
+
+// What one unit of the reading is, for the dB modes.
+typedef enum derived_unit {
+    DERIVED_UNIT_NONE,  // Not picked yet: no dB
+    DERIVED_UNIT_V,
+    DERIVED_UNIT_MV,
+} derived_unit_t;
+
+typedef struct derived {
+    derived_mode_t mode;
+    int32_t rel_ref;
+    uint8_t impedance;  // Index into the impedance table
+    uint8_t ratio;      // Index into the ratio table
+    derived_unit_t unit;
+} derived_t;
+
+// Builds the tables on first use; cheap after that.
+void derived_init(derived_t *d);
+// current is the latest value, the reference when mode is DERIVED_REL.
+void derived_set_mode(derived_t *d, derived_mode_t mode, int32_t current);
+// Steps the mode's setting: for DERIVED_DBV the unit, for DERIVED_DBM the
+// impedance and then the unit, the ratio, or for DERIVED_REL takes current as
+// the new reference.
+void derived_next_param(derived_t *d, int32_t current);
+// False when there is no result: DERIVED_OFF, dB of zero or with no unit,
+// or a scaled value out of range.
+bool derived_apply(const derived_t *d, int32_t value, int32_t *out);
+// Short description of the mode and setting, like "dBm 600R V".
+void derived_describe(const derived_t *d, char *buf, size_t len);
+
+// log2(x) in Q16, for x > 0.
+int32_t derived_log2_q16(uint32_t x);
@@ -0,0 +1,50 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "fluke8050-bus.h"
+#include "pattern-rle.h"
+#include "stddef.h"
+
+// Compiles readings into a pattern-rle.h program that drives an 8050A
+// display bus the way the meter does: for each latch in fluke8050_latch_t
+// order the data lines settle with every strobe low, then the latch's
+// strobe is held high for strobe_pages pages and dropped. Data never
+// changes in the same page as a strobe, as the sequencer writes set before
+// clear. The program plays the readings in order and starts over.
+//
+// The bus carries BCD to the CD4056 latches, not segments, so that is all
+// there is to mimic. Output pins are the sequencer's, GPIO0-31 only.
+//
+// Needs nothing from ESP-IDF, so it builds on the host with SEQUENCER_HOST.
+
+// Pages per latch besides the strobe: data, then strobe release.
+#define FLUKE8050_REPLAY_LATCH_PAGES 2
+// Program words for count readings: three RLE_OP_PAGE per latch and the
+// RLE_OP_EOP.
+#define FLUKE8050_REPLAY_WORDS(COUNT) ((COUNT)*FLUKE8050_STROBES * 9 + 1)
+// Pages one cycle of the program plays.
+#define FLUKE8050_REPLAY_PAGES(COUNT, STROBE_PAGES) \
+    ((COUNT)*FLUKE8050_STROBES *                    \
+     (FLUKE8050_REPLAY_LATCH_PAGES + (STROBE_PAGES)))
+
+// GPIO0-31 mask of the pins the program drives, 0 if any pin is above 31.
+uint32_t fluke8050_replay_gpios(const fluke8050_meter_config_t *pins);
+
+// Returns the words written, or 0 if out is smaller than
+// FLUKE8050_REPLAY_WORDS(count), a pin can't be driven or strobe_pages is 0.
+size_t fluke8050_replay_compile(const fluke8050_reading_t *readings,
+                                size_t count,
+                                const fluke8050_meter_config_t *pins,
+                                uint32_t strobe_pages, uint32_t *out,
+                                size_t max_words);
@@ -0,0 +1,47 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "fluke8050-bus.h"
+#include "stdbool.h"
+
+// Loopback self-test: the sequencer replays known readings on the out pins
+// (fluke8050-replay.h), jumpered to the in pins, while the APP cpu captures
+// them and the decoder reads them back the way the bus task would. The
+// page pacing is halved each run, so the log shows at what scan rate the
+// decode starts losing or mangling scans, and how long a scan takes from
+// its last strobe to being decoded.
+//
+// An out pin can be the in pin itself when that is below 32: the
+// sequencer drives it and the capture reads the pad back.
+typedef struct fluke8050_selftest_config {
+    fluke8050_meter_config_t out;
+    fluke8050_meter_config_t in;
+    uint32_t samples;  // Capture ring, power of two
+} fluke8050_selftest_config_t;
+
+// The default bus pins. GPIO13/17/21/22/27 drive themselves; jumper
+// GPIO25->32, 26->33, 2->36, 12->37, 14->38 and 15->39.
+#define FLUKE8050_SELFTEST_DEFAULT_CONFIG                         \
+    {                                                             \
+        .out = {.strobe_pins = {13, 17, 21, 22, 27, 25, 26},      \
+                .data_pins = {2, 12, 14, 15}},                    \
+        .in = {.strobe_pins = {13, 17, 21, 22, 27, 32, 33},       \
+               .data_pins = {36, 37, 38, 39}},                    \
+        .samples = 1024,                                          \
+    }
+
+// Takes over the sequencer and capture and leaves them stopped, so call it
+// before fluke8050_bus_start() or anything else that sets up banks. True if
+// any rate decoded without an error.
+bool fluke8050_selftest(const fluke8050_selftest_config_t *cfg);
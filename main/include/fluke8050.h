@@ -0,0 +1,75 @@
+#pragma once
+
+#include "stdint.h"
+
+#ifndef BIT
+#define BIT(X) (1 << X)
+#endif
+
+// The 8050A drives its LCD through seven 4 bit latches on a shared data
+// bus, one strobe each, scanned in this order.
+typedef enum fluke8050_latch {
+    LATCH_U10,  // indicators_t
+    LATCH_U11,  // sign_t
+    LATCH_U12,  // digit_t, most significant
+    LATCH_U13,
+    LATCH_U14,
+    LATCH_U15,
+    LATCH_U16,  // decimals_t
+    FLUKE8050_STROBES
+} fluke8050_latch_t;
+
+// U10
+typedef enum indicators {
+    IND_REL = BIT(0),
+    IND_BAT = BIT(1),
+    IND_HV = BIT(2),
+    IND_DB = BIT(3)
+} indicators_t;
+
+// U11
+typedef enum sign {
+    SIGN_PLUS = BIT(0),
+    SIGN_MINUS = BIT(1),
+    SIGN_ONE = BIT(2),
+    SIGN_BP = BIT(3)  // Blanking Period for LCD, Always Set.
+} sign_t;
+
+// U12-U15
+typedef enum digit {
+    CD4056_0 = 0,
+    CD4056_1 = 1,
+    CD4056_2 = 2,
+    CD4056_3 = 3,
+    CD4056_4 = 4,
+    CD4056_5 = 5,
+    CD4056_6 = 6,
+    CD4056_7 = 7,
+    CD4056_8 = 8,
+    CD4056_9 = 9,
+    CD4056_L = 10,
+    CD4056_H = 11,
+    CD4056_P = 12,
+    CD4056_A = 13,
+    CD4056_DASH = 14,
+    CD4056_OFF = 15
+} digit_t;
+
+// U16
+typedef enum decimals {
+    D0 = BIT(0),
+    D1 = BIT(1),
+    D2 = BIT(2),
+    D3 = BIT(3)
+} decimals_t;
+
+// One complete scan of the display.
+typedef struct fluke8050_reading {
+    indicators_t indicator_mask;
+    sign_t sign_mask;
+    decimals_t decimal_mask;
+    digit_t digits[4];
+
+    uint32_t seq;     // Counts published readings, starting at 1
+    int64_t time_us;  // esp_timer time of the scan's last strobe
+} fluke8050_reading_t;
@@ -0,0 +1,56 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+// Run-length pattern format for the APP cpu sequencer. A program is a list
+// of 32 bit words; each op word holds the op in its top 4 bits and a count
+// in the rest:
+//
+//   RLE_OP_PAGE n, set, clear  emit the page n times
+//   RLE_OP_LOOP n              repeat everything up to the matching
+//                              RLE_OP_END n times
+//   RLE_OP_END
+//   RLE_OP_EOP                 end of the pattern cycle, start over
+//
+// This file has no ESP-IDF dependencies so patterns can be built off-target.
+#define RLE_OP_SHIFT 28
+#define RLE_COUNT_MASK ((1UL << RLE_OP_SHIFT) - 1)
+#define RLE_MAX_DEPTH 4
+
+typedef enum rle_op {
+    RLE_OP_PAGE = 1,
+    RLE_OP_LOOP = 2,
+    RLE_OP_END = 3,
+    RLE_OP_EOP = 4
+} rle_op_t;
+
+#define RLE_WORD(OP, N) (((uint32_t)(OP) << RLE_OP_SHIFT) | ((N)&RLE_COUNT_MASK))
+#define RLE_GET_OP(W) ((W) >> RLE_OP_SHIFT)
+#define RLE_GET_COUNT(W) ((W)&RLE_COUNT_MASK)
+
+// Encodes count flat pages (set/clear pairs, stride 2 words) into out.
+// Returns the number of words written including the final RLE_OP_EOP, or 0
+// if out is too small.
+size_t rle_encode(const uint32_t *pages, size_t count, uint32_t *out,
+                  size_t max_words);
+
+// Checks a program is well formed: known ops, non-zero counts, balanced
+// loops no deeper than RLE_MAX_DEPTH and a terminating RLE_OP_EOP.
+bool rle_validate(const uint32_t *prog, size_t words);
+
+// Number of pages one cycle of the program emits, saturating at UINT64_MAX.
+uint64_t rle_decoded_length(const uint32_t *prog, size_t words);
@@ -0,0 +1,73 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "esp32-cpu1.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+// Compiles per-pin waveform descriptions into sequencer pages. Times are in
+// CPU cycles: each pin's period, duty and phase are rounded to a cycle at
+// cpu_hz, the pattern repeats every least common multiple of the periods,
+// and every page is as long as the greatest common divisor of all edge
+// times, so a 1kHz square wave is 2 pages however fast the CPU runs.
+//
+// Every page writes the full state of every pin it drives, so a pattern
+// can be swapped in at any page and the pins come out right.
+//
+// This file has no ESP-IDF dependencies so patterns can be built off-target.
+typedef enum wave_kind {
+    WAVE_CLOCK,  // hz, duty, phase
+    WAVE_BITS    // hz bits/s, bits, phase; loops over the bits
+} wave_kind_t;
+
+typedef struct wave_pin {
+    uint8_t pin;  // GPIO0-31
+    wave_kind_t kind;
+    uint32_t hz;
+    uint8_t duty;     // WAVE_CLOCK: percent high
+    uint16_t phase;   // Degrees of the pin's own period, delays the pin
+    const uint8_t *bits;  // WAVE_BITS: bit i is bits[i / 8] >> (i % 8) & 1
+    uint16_t nbits;
+} wave_pin_t;
+
+typedef enum wave_status {
+    WAVE_OK = 0,
+    WAVE_EINVAL,     // Bad pin, zero rate, rate above cpu_hz, empty bits
+    WAVE_ETOOLONG,   // The common period overflows 32 bits of cycles
+    WAVE_ENOSPC,     // More pages than max_pages
+    WAVE_ETOOSHORT   // A timed page below TIMED_PAGE_MIN_CYCLES
+} wave_status_t;
+
+typedef struct wave_program {
+    uint32_t period_cycles;  // One cycle of the whole pattern
+    uint32_t step_cycles;    // Flat pages: CPU1_SET_PACING for the pattern
+    uint32_t pages;          // Pages written
+    uint32_t gpios;          // Pins driven
+} wave_program_t;
+
+// One page every step_cycles, for write_set_bank()/write_clear_bank() or
+// rle_encode() (with set and clear interleaved).
+wave_status_t wave_compile_flat(const wave_pin_t *pins, size_t count,
+                                uint32_t cpu_hz, uint32_t *set,
+                                uint32_t *clear, size_t max_pages,
+                                wave_program_t *out);
+
+// A page per change of state, for write_timed_bank(). step_cycles is the
+// grid the page lengths are multiples of.
+wave_status_t wave_compile_timed(const wave_pin_t *pins, size_t count,
+                                 uint32_t cpu_hz, timed_page_t *pages,
+                                 size_t max_pages, wave_program_t *out);
+
+const char *wave_strerror(wave_status_t status);
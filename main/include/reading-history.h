@@ -0,0 +1,70 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+// Fixed size history of timestamped values with running statistics. The
+// caller provides the storage, nothing is allocated, and every push is O(1).
+// Not locked: one writer, and readers must keep it from running meanwhile.
+//
+// Samples are numbered from 0 in push order. Once the ring wraps only the
+// last capacity of them are kept; the statistics cover every sample since
+// the last history_reset(). A push is integer adds and one 64 bit multiply,
+// cheap enough for a spinlock; the mean and deviation are worked out from
+// the sums by whoever reads them.
+typedef struct history_sample {
+    uint32_t time_ms;  // Wraps after 49 days
+    int32_t value;
+} history_sample_t;
+
+typedef struct history_stats {
+    uint32_t count;
+    int32_t min;
+    int32_t max;
+    // Sums of each sample less the first, so they stay small while readings
+    // hold near one value. sum2 is exact while count * (max - min)^2 fits
+    // 64 bits, which takes over 10000 full scale swings of the 1999.9 range,
+    // and saturates after that.
+    int32_t base;
+    int64_t sum;
+    uint64_t sum2;
+    uint32_t first_ms;
+    uint32_t last_ms;
+} history_stats_t;
+
+typedef struct reading_history {
+    history_sample_t *samples;
+    uint32_t capacity;
+    uint32_t total;  // Samples pushed since the last reset
+    history_stats_t stats;
+} reading_history_t;
+
+void history_init(reading_history_t *h, history_sample_t *samples,
+                  uint32_t capacity);
+void history_reset(reading_history_t *h);
+void history_push(reading_history_t *h, uint32_t time_ms, int32_t value);
+// Number of the oldest sample still held; samples run up to h->total.
+uint32_t history_first(const reading_history_t *h);
+// Copies up to max samples starting at number from, skipping forward past
+// any that have been overwritten. Returns how many were copied and sets
+// *next to the number after the last one.
+size_t history_copy(const reading_history_t *h, uint32_t from,
+                    history_sample_t *out, size_t max, uint32_t *next);
+// Rounded to the nearest value, 0 for no samples.
+int32_t history_mean(const history_stats_t *stats);
+// Sample standard deviation, rounded down; 0 for fewer than two samples and
+// -1 once sum2 has saturated.
+int32_t history_stddev(const history_stats_t *stats);
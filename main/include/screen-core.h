@@ -1,13 +1,17 @@
 #pragma once
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
-#include "freertos/task.h"
+#include "display-port.h"
 #include "lvgl/lvgl.h"
 
 typedef enum display_mode {
     FLUKE_8050A = 0,
-    MAX_DISPLAY_MODE = FLUKE_8050A
+    FLUKE_8050A_2,  // Further fluke8050-bus meters, when configured
+    FLUKE_8050A_3,
+    FLUKE_8050A_4,
+    FLUKE_8050A_SEG7,
+    TREND,
+    DIAGNOSTICS,
+    MAX_DISPLAY_MODE = DIAGNOSTICS
 } display_mode_t;
 
 typedef void *screen_handle_t;
@@ -15,6 +19,86 @@ typedef void *display_handle_t;
 
 typedef void (*tick_callback_t)(lv_obj_t *screen, void *priv);
 
+// From data being stamped by its source to the refresh that drew it being
+// handed to the flush.
+typedef struct display_latency {
+    int64_t last_us;
+    int64_t max_us;
+    int64_t total_us;
+    uint32_t frames;
+} display_latency_t;
+
+// The flush pipeline. LVGL renders into one buffer while the other's SPI
+// DMA transfer runs; it only stalls when it needs a buffer that is still
+// being sent. Buffers are DMA capable and sized from the free DMA heap.
+typedef struct display_flush_stats {
+    uint16_t buf_lines;  // Lines per buffer
+    uint8_t buffers;     // 1 when there was only room for one
+    uint32_t flushes;    // Areas handed to the driver
+    uint64_t bytes;
+    int64_t flush_us;    // In the driver's flush call, queueing the DMA
+    uint32_t stalls;     // Times LVGL had to wait for a transfer
+    int64_t wait_us;
+    uint32_t refreshes;
+} display_flush_stats_t;
+
+// The display task sleeps until LVGL's next task is due or display_wake();
+// busy_us is its time awake, all of it on CPU0.
+typedef struct display_task_stats {
+    uint32_t wakeups;
+    uint32_t notified;  // Of those, woken by display_wake()
+    int64_t busy_us;
+} display_task_stats_t;
+
+// Screens are built on their first show_display(). After a switch the one
+// left stays built, warm, while the warm screens fit in set_screen_budget();
+// past that the one shown longest ago is destroyed. When the display task
+// is idle, the screen next_display_mode() leads to is built ahead if the
+// budget allows. Switch times run from show_display() to the screen being
+// loaded, before its slide in.
+typedef struct display_screen_stats {
+    uint32_t switches;
+    uint32_t cold_switches;  // Of those, had to build the screen
+    int64_t last_switch_us;
+    int64_t max_cold_us;
+    int64_t max_warm_us;
+    uint32_t builds;      // Including prefetches
+    uint32_t prefetches;
+    uint32_t destroys;
+    uint32_t warm_bytes;  // LVGL pool and heap held by warm screens
+    uint32_t lv_free;      // LVGL's pool now
+    uint32_t lv_max_used;  // LVGL's pool high-water mark
+    uint32_t heap_min_free;  // 8-bit heap low-water mark since boot
+} display_screen_stats_t;
+
 void set_brightness(uint16_t brightness);
 uint16_t get_brightness();
-display_handle_t init_display();
\ No newline at end of file
+display_handle_t init_display();
+// Switches screens at the next frame set_max_fps() allows.
+void show_display(display_handle_t disp_handle, display_mode_t disp);
+// The mode after disp that has a screen, wrapping around.
+display_mode_t next_display_mode(display_handle_t disp_handle,
+                                 display_mode_t disp);
+// New data for the current screen: run its tick and refresh right away.
+// Safe from any task.
+void display_wake(display_handle_t disp_handle);
+// Caps how often display_wake() can force a refresh, 0 for no cap.
+void set_max_fps(uint8_t fps);
+// Called by a screen's tick when it draws data stamped at source_us.
+void display_mark_update(int64_t source_us);
+void display_get_latency(display_latency_t *out);
+void display_get_flush_stats(display_flush_stats_t *out);
+void display_get_task_stats(display_task_stats_t *out);
+// Bytes warm screens may hold, 0 to destroy each screen once left. Safe
+// from any task.
+void set_screen_budget(uint32_t bytes);
+// Display task only, as it reads LVGL's pool.
+void display_get_screen_stats(display_screen_stats_t *out);
+
+#ifdef DISPLAY_HOST
+// In place of init_display() on a host, after lv_init() and with the
+// panel from display-port-sim.h. display_host_step() is one pass of the
+// display task's loop; call it every portTICK_PERIOD_MS of simulated time.
+display_handle_t display_host_start(int screen_count);
+void display_host_step(display_handle_t disp_handle);
+#endif
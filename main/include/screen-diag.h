@@ -0,0 +1,10 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "lvgl/lvgl.h"
+
+void *diag_screen_init(lv_obj_t *screen);
+void diag_screen_worker(lv_obj_t *screen, void *priv);
+void diag_screen_free(lv_obj_t *screen, void *priv);
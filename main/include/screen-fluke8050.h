@@ -1,9 +1,18 @@
 #pragma once
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
-#include "freertos/task.h"
+#include "display-port.h"
 #include "lvgl/lvgl.h"
+#include "stdint.h"
 
-void *fluke8050_screen_init(lv_obj_t *screen);
-void fluke8050_screen_worker(lv_obj_t *screen, void *priv);
\ No newline at end of file
+// meter is the fluke8050-bus meter the screen shows.
+void *fluke8050_screen_init(lv_obj_t *screen, uint8_t meter);
+void fluke8050_screen_worker(lv_obj_t *screen, void *priv);
+// Same screen with the reading drawn by the seven segment widget.
+void *fluke8050_seg7_screen_init(lv_obj_t *screen, uint8_t meter);
+// Either view's priv, before the screen is deleted.
+void fluke8050_screen_free(lv_obj_t *screen, void *priv);
+// Step the derived reading's mode, or its setting: dB unit and impedance,
+// scale ratio or REL reference. Each meter keeps its own; a step goes to the
+// meter on screen. Safe from any task; applied with the next reading.
+void fluke8050_derived_next_mode();
+void fluke8050_derived_next_param();
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "display-port.h"
+#include "lvgl/lvgl.h"
+
+// meter is the fluke8050-bus meter the chart shows.
+void *trend_screen_init(lv_obj_t *screen, uint8_t meter);
+void trend_screen_worker(lv_obj_t *screen, void *priv);
+void trend_screen_load(lv_obj_t *screen, void *priv);
+void trend_screen_unload(lv_obj_t *screen, void *priv);
+void trend_screen_free(lv_obj_t *screen, void *priv);
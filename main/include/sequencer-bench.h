@@ -0,0 +1,20 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+// Plays the same patterns as flat and run-length banks on GPIO25/26 and logs
+// pages/s and bytes per bank for each, then the bank switch latency. Takes
+// over the sequencer and leaves it deinitialised, so call it before anything
+// else sets up banks.
+void sequencer_benchmark();
@@ -0,0 +1,146 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <stdio.h>
+
+#include "esp32-cpu1.h"
+#include "pattern-rle.h"
+#include "sequencer-port.h"
+
+// Hardware independent half of the sequencer: the state shared by both
+// cores, command validation and everything the APP cpu runs. esp32-cpu1.c
+// is the PRO cpu side and owns allocation, interrupts and startup.
+
+#define STRX(a) #a
+#define STR(a) STRX(a)
+
+#define ERR_ON(X, Y)                              \
+    if (X) {                                      \
+        printf("%s: %s\n", __FUNCTION__, STR(X)); \
+        Y;                                        \
+    }
+
+// All banks live in one arena of pages, bank-major, so the APP cpu walks a
+// single sequential run of memory per page cycle. Pages are gpio_page_t, or
+// timed_page_t when the arena was set up with init_gpios_timed(). RLE banks
+// are bank_words words of program each.
+// While modified from the PRO cpu, these do not need to be volatile
+// as we only resize the arena with output stopped.
+extern volatile void *volatile arena;
+extern volatile pattern_format_t pattern_format;
+extern volatile uint8_t page_size;
+extern volatile uint8_t banks;
+extern volatile uint8_t pages;
+extern volatile uint16_t bank_words;
+
+// 0xFF means inactive, written by the APP cpu.
+extern volatile uint8_t active_bank;
+
+// Command mailbox. The PRO cpu is the only writer of cmd_head and the APP cpu
+// the only writer of cmd_tail and status, so neither side needs a lock.
+// Commands between resp_tail and cmd_tail have been applied and their status
+// is waiting for the FROM_CPU_INTR2 handler; a slot is only reused once that
+// handler has moved resp_tail past it.
+typedef struct mailbox {
+    volatile cpu1_cmd_t cmd[CPU1_MAILBOX_SIZE];
+    volatile uint8_t status[CPU1_MAILBOX_SIZE];
+    volatile uint32_t cmd_head;
+    volatile uint32_t cmd_tail;
+    volatile uint32_t resp_tail;
+} mailbox_t;
+
+extern mailbox_t mailbox;
+
+#define SLOT(X) ((X) & (CPU1_MAILBOX_SIZE - 1))
+
+// Timed playback statistics, written by the APP cpu only.
+extern volatile uint32_t timed_worst_jitter;
+extern volatile uint32_t timed_late_pages;
+
+// Input capture ring. The APP cpu is the only writer of head and the PRO
+// cpu the only writer of tail, so neither side needs a lock. buf and cfg are
+// set up before CPU1_CAPTURE_START and only freed after CPU1_CAPTURE_STOP
+// has completed.
+typedef struct capture_ring {
+    volatile capture_sample_t *buf;
+    uint32_t mask;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t samples;
+    volatile uint32_t overflows;
+    capture_config_t cfg;
+
+    // APP cpu private
+    uint32_t next_ccount;
+    uint32_t last_ccount;
+    uint32_t last_in;
+    uint32_t last_in1;
+} capture_ring_t;
+
+extern capture_ring_t capture;
+extern volatile bool capture_enabled;
+
+// Page timing statistics, written by the APP cpu only and read through
+// CPU1_READ_STATS.
+typedef struct page_stats {
+    uint32_t hist[CPU1_HIST_BUCKETS];
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t periods;
+    uint32_t stalls;
+    uint32_t bank_switches;
+    uint32_t last;  // CCOUNT of the previous page write
+} page_stats_t;
+
+extern page_stats_t page_stats;
+
+// With nothing to output or capture the APP cpu halts itself. It sets
+// app_cpu_parked first and re-checks for work, so the PRO cpu only has to
+// wake it when it sees the flag. app_cpu_wakeups counts resumes so the
+// wake latency can be matched up in the FROM_CPU_INTR2 handler.
+extern volatile bool app_cpu_parked;
+extern volatile uint32_t app_cpu_wakeups;
+
+static inline IRAM_ATTR volatile gpio_page_t *page_at(uint8_t bank,
+                                                     uint8_t idx) {
+    return (volatile gpio_page_t *)((volatile uint8_t *)arena +
+                                    (bank * pages + idx) * page_size);
+}
+
+static inline IRAM_ATTR volatile uint32_t *prog_at(uint8_t bank) {
+    return (volatile uint32_t *)arena + bank * bank_words;
+}
+
+static inline uint8_t field_count(uint8_t fields) {
+    return ((fields & PATCH_SET) != 0) + ((fields & PATCH_CLEAR) != 0) +
+           ((fields & PATCH_CYCLES) != 0);
+}
+
+// Outputs a patch will drive, from src laid out as described for
+// patch_pages().
+uint32_t patch_gpios(uint8_t len, uint8_t fields, const uint32_t *src,
+                     uint8_t stride);
+// Outputs a bank drives, 0 for bank 0xFF.
+uint32_t bank_gpios(uint8_t bank);
+// What an unpaced page costs the APP cpu at most, capture polling included.
+#define FREE_PAGE_CYCLES 64
+// Upper bound on one page cycle of bank in CPU cycles when paced at
+// pace_cycles, 0 for bank 0xFF. Saturates rather than wrapping.
+uint64_t bank_cycle_cycles(uint8_t bank, uint32_t pace_cycles);
+// PRO cpu side validation of a command before it is queued.
+bool check_cmd(const cpu1_cmd_t *cmd);
+
+// The APP cpu's main loop. Never returns.
+void sequencer_main(void);
@@ -0,0 +1,95 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+// Simulated port for running the sequencer on the host, built by
+// main/host/CMakeLists.txt with -DSEQUENCER_HOST. esp32-cpu1.c is the PRO
+// cpu as on the target; where it would start the APP cpu, sim_start() runs
+// sequencer_main() on its own pthread and FROM_CPU_INTR2 becomes a call on
+// that thread.
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+// seq_ccount() ticks at 240MHz of host monotonic time.
+#define SIM_CPU_HZ 240000000ULL
+
+typedef struct sim_event {
+    uint32_t ccount;
+    uint32_t set;
+    uint32_t clear;
+} sim_event_t;
+
+uint32_t seq_ccount();
+static inline void seq_memw() {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+void seq_out(uint32_t set, uint32_t clear);
+void seq_in(uint32_t *in, uint32_t *in1);
+void seq_notify();
+void seq_halt();
+
+// A plain spinlock: the two sides are threads on different host cores, as
+// they are cpus on the target.
+typedef struct seq_lock {
+    bool held;
+} seq_lock_t;
+#define SEQ_LOCK_INIT {0}
+
+static inline void seq_lock(seq_lock_t *lock) {
+    while (__atomic_test_and_set(&lock->held, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+static inline void seq_unlock(seq_lock_t *lock) {
+    __atomic_clear(&lock->held, __ATOMIC_RELEASE);
+}
+
+int64_t seq_time_us();
+static inline uint32_t seq_cpu_hz() {
+    return SIM_CPU_HZ;
+}
+void seq_enable(uint32_t set, uint32_t clear);
+static inline void seq_ack() {
+}
+bool seq_running();
+void seq_resume();
+// Yields, so the APP cpu thread gets to run even on a single core host.
+void seq_spin();
+void *seq_alloc(size_t bytes, bool exec);
+void seq_free(void *ptr);
+
+// Harness side. Every seq_out() is recorded into a ring of events (a power
+// of two) that sim_events() drains; writes that find it full are counted by
+// sim_dropped() instead. Set up before anything starts the sequencer, and
+// only torn down if nothing did.
+bool sim_init(size_t events);
+void sim_deinit();
+size_t sim_events(sim_event_t *out, size_t max);
+uint32_t sim_dropped();
+// Output latch after every write so far, like GPIO.out.
+uint32_t sim_out_state();
+void sim_set_inputs(uint32_t in, uint32_t in1);
+// Called from the sequencer thread on seq_notify(), where the target would
+// take FROM_CPU_INTR2.
+void sim_set_notify(void (*cb)(void *));
+// Resumes a sequencer parked in seq_halt().
+void sim_wake();
+// Starts sequencer_main() on a new thread, with isr as the notify callback.
+// Called once, by the first esp32-cpu1.c call that needs the APP cpu.
+bool sim_start(void (*isr)(void *));
+// Outputs enabled so far, like GPIO.enable.
+uint32_t sim_enabled();
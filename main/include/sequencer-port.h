@@ -0,0 +1,136 @@
+// Copyright 2022 Patrick Erley <paerley@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+// The few things the sequencer core needs from the hardware. On the ESP32
+// they are inlined register accesses; with SEQUENCER_HOST defined they come
+// from sequencer-port-sim.h instead.
+//
+//   seq_ccount()       free running cycle counter
+//   seq_memw()         order memory accesses between the two cores
+//   seq_out(set, clr)  one page: GPIO.out_w1ts then GPIO.out_w1tc
+//   seq_in(in, in1)    GPIO0-31 and GPIO32-39
+//   seq_notify()       raise FROM_CPU_INTR2 on the PRO cpu
+//   seq_halt()         stop until the PRO cpu wakes us
+//
+// and from the PRO cpu side in esp32-cpu1.c:
+//
+//   seq_lock_t         lock shared with the FROM_CPU_INTR2 handler
+//   seq_lock(l)        portENTER_CRITICAL_SAFE()
+//   seq_unlock(l)      portEXIT_CRITICAL_SAFE()
+//   seq_time_us()      esp_timer_get_time()
+//   seq_cpu_hz()       esp_clk_cpu_freq(), the rate seq_ccount() ticks at
+//   seq_enable(s, c)   GPIO.enable_w1ts then GPIO.enable_w1tc
+//   seq_ack()          clear FROM_CPU_INTR2 in its handler
+//   seq_running()      the APP cpu's clock is not gated
+//   seq_resume()       ungate it
+//   seq_spin()         once per pass of a busy wait for the APP cpu
+//   seq_alloc(n, x)    internal memory, executable if x
+//   seq_free(p)
+#ifdef SEQUENCER_HOST
+#include "sequencer-port-sim.h"
+#else
+#include "esp32/clk.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "soc/dport_reg.h"
+#include "soc/gpio_struct.h"
+#include "xtensa/core-macros.h"
+
+static inline IRAM_ATTR uint32_t seq_ccount() {
+    return XTHAL_GET_CCOUNT();
+}
+
+static inline IRAM_ATTR void seq_memw() {
+    asm volatile("memw" ::: "memory");
+}
+
+static inline IRAM_ATTR void seq_out(uint32_t set, uint32_t clear) {
+    GPIO.out_w1ts = set;
+    GPIO.out_w1tc = clear;
+}
+
+static inline IRAM_ATTR void seq_in(uint32_t *in, uint32_t *in1) {
+    *in = GPIO.in;
+    *in1 = GPIO.in1.data;
+}
+
+static inline IRAM_ATTR void seq_notify() {
+    DPORT_WRITE_PERI_REG(DPORT_CPU_INTR_FROM_CPU_2_REG,
+                         DPORT_CPU_INTR_FROM_CPU_2);
+}
+
+// The APP cpu gates its own clock; wake_app_cpu() ungates it.
+static inline IRAM_ATTR void seq_halt() {
+    DPORT_REG_CLR_BIT(DPORT_APPCPU_CTRL_B_REG, DPORT_APPCPU_CLKGATE_EN);
+    // The clock stops here until wake_app_cpu() ungates it.
+    asm volatile("memw\n nop\n nop\n nop\n nop\n" ::: "memory");
+}
+
+typedef portMUX_TYPE seq_lock_t;
+#define SEQ_LOCK_INIT portMUX_INITIALIZER_UNLOCKED
+
+static inline IRAM_ATTR void seq_lock(seq_lock_t *lock) {
+    portENTER_CRITICAL_SAFE(lock);
+}
+
+static inline IRAM_ATTR void seq_unlock(seq_lock_t *lock) {
+    portEXIT_CRITICAL_SAFE(lock);
+}
+
+static inline int64_t seq_time_us() {
+    return esp_timer_get_time();
+}
+
+static inline uint32_t seq_cpu_hz() {
+    return esp_clk_cpu_freq();
+}
+
+static inline IRAM_ATTR void seq_enable(uint32_t set, uint32_t clear) {
+    GPIO.enable_w1ts = set;
+    GPIO.enable_w1tc = clear;
+}
+
+static inline IRAM_ATTR void seq_ack() {
+    DPORT_WRITE_PERI_REG(DPORT_CPU_INTR_FROM_CPU_2_REG, 0);
+}
+
+static inline IRAM_ATTR bool seq_running() {
+    return DPORT_REG_GET_BIT(DPORT_APPCPU_CTRL_B_REG, DPORT_APPCPU_CLKGATE_EN);
+}
+
+static inline IRAM_ATTR void seq_resume() {
+    DPORT_REG_SET_BIT(DPORT_APPCPU_CTRL_B_REG, DPORT_APPCPU_CLKGATE_EN);
+}
+
+static inline IRAM_ATTR void seq_spin() {
+}
+
+// Executable memory is IRAM, which only allows 32 bit accesses.
+static inline void *seq_alloc(size_t bytes, bool exec) {
+    if (exec) {
+        return heap_caps_malloc(bytes, MALLOC_CAP_EXEC | MALLOC_CAP_32BIT);
+    }
+    return heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+static inline void seq_free(void *ptr) {
+    heap_caps_free(ptr);
+}
+#endif
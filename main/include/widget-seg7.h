@@ -0,0 +1,43 @@
+#pragma once
+
+#include "lvgl/lvgl.h"
+
+#ifndef BIT
+#define BIT(X) (1 << X)
+#endif
+
+// Seven segment display drawn straight from a table of rectangles. Only
+// segments that change are invalidated, so a new reading redraws and
+// flushes a few small areas instead of whole glyphs, and no font is
+// touched.
+//
+// Each cell is a digit with a decimal point to its left, the way the 8050A
+// shows it. SEG7_BAR is a vertical bar through G, for '+'.
+typedef enum seg7_segment {
+    SEG7_A = BIT(0),
+    SEG7_B = BIT(1),
+    SEG7_C = BIT(2),
+    SEG7_D = BIT(3),
+    SEG7_E = BIT(4),
+    SEG7_F = BIT(5),
+    SEG7_G = BIT(6),
+    SEG7_DP = BIT(7),
+    SEG7_BAR = BIT(8)
+} seg7_segment_t;
+#define SEG7_SEGMENTS 9
+
+typedef struct seg7_geometry {
+    lv_coord_t width;      // Of a digit, without its decimal point
+    lv_coord_t height;
+    lv_coord_t thickness;  // Of a segment
+    lv_coord_t gap;        // Between a digit and its neighbours
+} seg7_geometry_t;
+
+lv_obj_t *seg7_create(lv_obj_t *parent, const seg7_geometry_t *geo,
+                      uint8_t cells);
+void seg7_set_colors(lv_obj_t *seg7, lv_color_t on, lv_color_t off);
+// Invalidates the segments of cell that differ from segs.
+void seg7_set_cell(lv_obj_t *seg7, uint8_t cell, uint16_t segs);
+uint16_t seg7_get_cell(const lv_obj_t *seg7, uint8_t cell);
+// Segment areas invalidated by seg7_set_cell() since creation.
+uint32_t seg7_get_invalidations(const lv_obj_t *seg7);
@@ -0,0 +1,147 @@
+#include "display-profile.h"
+
+#include "display-port.h"
+#include "inttypes.h"
+#include "lvgl/lvgl.h"
+#include "stdio.h"
+
+static frame_profile_t ring[PROFILE_FRAMES];
+static uint32_t total = 0;
+static uint32_t handler_from = 0;
+
+static lv_obj_t *overlay = NULL;
+static int64_t overlay_us = 0;
+static volatile uint32_t toggle_requests = 0;
+static uint32_t toggles_applied = 0;
+
+static uint32_t oldest() {
+    return total > PROFILE_FRAMES ? total - PROFILE_FRAMES : 0;
+}
+
+void profile_record(const frame_profile_t *frame) {
+    ring[total % PROFILE_FRAMES] = *frame;
+    total++;
+}
+
+void profile_handler_done(uint32_t us) {
+    uint32_t i = handler_from > oldest() ? handler_from : oldest();
+    for (; i < total; i++) {
+        ring[i % PROFILE_FRAMES].handler_us = us;
+    }
+    handler_from = total;
+}
+
+size_t profile_copy(frame_profile_t *out, size_t max) {
+    size_t n = 0;
+    for (uint32_t i = oldest(); i < total && n < max; i++) {
+        out[n++] = ring[i % PROFILE_FRAMES];
+    }
+    return n;
+}
+
+void profile_summarize(profile_summary_t *out) {
+    uint64_t frame = 0, flush = 0, wait = 0, tick = 0, handler = 0, px = 0;
+    *out = (profile_summary_t){0};
+    for (uint32_t i = oldest(); i < total; i++) {
+        const frame_profile_t *f = &ring[i % PROFILE_FRAMES];
+        frame += f->frame_us;
+        flush += f->flush_us;
+        wait += f->wait_us;
+        tick += f->tick_us;
+        handler += f->handler_us;
+        px += f->px;
+        if (f->frame_us > out->frame_max_us) {
+            out->frame_max_us = f->frame_us;
+        }
+        out->frames++;
+    }
+    if (out->frames == 0) {
+        return;
+    }
+    out->frame_avg_us = frame / out->frames;
+    out->flush_avg_us = flush / out->frames;
+    out->wait_avg_us = wait / out->frames;
+    out->tick_avg_us = tick / out->frames;
+    out->handler_avg_us = handler / out->frames;
+    out->px_avg = px / out->frames;
+
+    // Over the ring's span, so an idle screen reads as a low rate.
+    uint32_t span_ms = ring[(total - 1) % PROFILE_FRAMES].end_ms -
+                       ring[oldest() % PROFILE_FRAMES].end_ms;
+    if (span_ms != 0) {
+        out->fps_x10 = (out->frames - 1) * 10000 / span_ms;
+    }
+}
+
+void profile_dump() {
+    printf("profile: end_ms frame flush wait tick handler us, px inval "
+           "areas\n");
+    for (uint32_t i = oldest(); i < total; i++) {
+        const frame_profile_t *f = &ring[i % PROFILE_FRAMES];
+        printf("profile: %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu32
+               " %" PRIu32 " %" PRIu32 ", %" PRIu32 " %u %u\n",
+               f->end_ms, f->frame_us, f->flush_us, f->wait_us, f->tick_us,
+               f->handler_us, f->px, f->invalidations, f->areas);
+    }
+    profile_summary_t s;
+    profile_summarize(&s);
+    printf("profile: %" PRIu32 " frames, %" PRIu32 ".%" PRIu32
+           " fps, frame %" PRIu32 "/%" PRIu32 " us, flush %" PRIu32
+           " wait %" PRIu32 " tick %" PRIu32 " handler %" PRIu32
+           " us, %" PRIu32 " px\n",
+           s.frames, s.fps_x10 / 10, s.fps_x10 % 10, s.frame_avg_us,
+           s.frame_max_us, s.flush_avg_us, s.wait_avg_us, s.tick_avg_us,
+           s.handler_avg_us, s.px_avg);
+}
+
+void profile_toggle() { toggle_requests++; }
+
+static void show_overlay(bool show) {
+    static lv_style_t style;
+    static bool style_ready = false;
+    if (!show) {
+        lv_obj_del(overlay);
+        overlay = NULL;
+        return;
+    }
+    if (!style_ready) {
+        lv_style_init(&style);
+        lv_style_set_text_font(&style, LV_STATE_DEFAULT,
+                               &lv_font_montserrat_12);
+        lv_style_set_text_color(&style, LV_STATE_DEFAULT, LV_COLOR_YELLOW);
+        lv_style_set_bg_color(&style, LV_STATE_DEFAULT, LV_COLOR_BLACK);
+        lv_style_set_bg_opa(&style, LV_STATE_DEFAULT, LV_OPA_COVER);
+        style_ready = true;
+    }
+    overlay = lv_label_create(lv_layer_top(), NULL);
+    lv_obj_add_style(overlay, LV_LABEL_PART_MAIN, &style);
+    lv_label_set_text(overlay, "profiling");
+    lv_obj_set_pos(overlay, 0, 0);
+    overlay_us = 0;
+}
+
+void profile_overlay_update() {
+    while (toggles_applied != toggle_requests) {
+        toggles_applied++;
+        show_overlay(overlay == NULL);
+        profile_dump();
+    }
+    if (overlay == NULL) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (now - overlay_us < 1000000) {
+        return;
+    }
+    overlay_us = now;
+
+    profile_summary_t s;
+    profile_summarize(&s);
+    char buff[64];
+    snprintf(buff, sizeof(buff),
+             "%" PRIu32 ".%" PRIu32 "fps %" PRIu32 "/%" PRIu32 "us f%" PRIu32
+             " w%" PRIu32 " %" PRIu32 "px",
+             s.fps_x10 / 10, s.fps_x10 % 10, s.frame_avg_us, s.frame_max_us,
+             s.flush_avg_us, s.wait_avg_us, s.px_avg);
+    lv_label_set_text(overlay, buff);
+}
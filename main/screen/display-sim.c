@@ -0,0 +1,148 @@
+// Host only, not part of the firmware build.
+#ifdef DISPLAY_HOST
+#include "display-port-sim.h"
+
+#include "fluke8050-bus.h"
+#include "fluke8050-decoder.h"
+#include "string.h"
+
+// The sequencer isn't running, so the title's page count stays at 0.
+volatile DRAM_ATTR uint32_t cpu1_counter = 0;
+
+static int64_t now_us = 0;
+
+int64_t esp_timer_get_time() { return now_us; }
+
+void sim_advance_us(int64_t us) { now_us += us; }
+
+struct sim_queue {
+    uint8_t *items;
+    uint32_t length;
+    uint32_t item_size;
+    uint32_t head;
+    uint32_t count;
+};
+
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size) {
+    QueueHandle_t q = calloc(1, sizeof(struct sim_queue));
+    if (q == NULL) {
+        return NULL;
+    }
+    q->items = calloc(length, item_size);
+    if (q->items == NULL) {
+        free(q);
+        return NULL;
+    }
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait) {
+    if (q->count == q->length) {
+        return pdFALSE;
+    }
+    uint32_t tail = (q->head + q->count) % q->length;
+    memcpy(q->items + tail * q->item_size, item, q->item_size);
+    q->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait) {
+    if (q->count == 0) {
+        return pdFALSE;
+    }
+    memcpy(item, q->items + q->head * q->item_size, q->item_size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    return pdTRUE;
+}
+
+static lv_color_t frame[CONFIG_LV_DISPLAY_HEIGHT][CONFIG_LV_DISPLAY_WIDTH];
+
+// Done as soon as it is copied, so LVGL never waits on a transfer.
+void sim_display_flush(lv_disp_drv_t *drv, const lv_area_t *area,
+                       lv_color_t *color_map) {
+    for (lv_coord_t y = area->y1; y <= area->y2; y++) {
+        for (lv_coord_t x = area->x1; x <= area->x2; x++, color_map++) {
+            if (x >= 0 && x < CONFIG_LV_DISPLAY_WIDTH && y >= 0 &&
+                y < CONFIG_LV_DISPLAY_HEIGHT) {
+                frame[y][x] = *color_map;
+            }
+        }
+    }
+    lv_disp_flush_ready(drv);
+}
+
+const lv_color_t *sim_framebuffer() { return &frame[0][0]; }
+
+typedef struct sim_meter {
+    fluke8050_reading_t latest;
+    reading_history_t history;
+    history_sample_t samples[FLUKE8050_HISTORY_SAMPLES];
+} sim_meter_t;
+
+static sim_meter_t bus[FLUKE8050_MAX_METERS];
+static uint8_t meters = 0;
+
+void sim_bus_set_meters(uint8_t count) {
+    meters = count < FLUKE8050_MAX_METERS ? count : FLUKE8050_MAX_METERS;
+    for (int m = 0; m < meters; m++) {
+        memset(&bus[m].latest, 0, sizeof(bus[m].latest));
+        history_init(&bus[m].history, bus[m].samples,
+                     FLUKE8050_HISTORY_SAMPLES);
+    }
+}
+
+void sim_bus_publish(uint8_t meter, fluke8050_reading_t *r) {
+    if (meter >= meters) {
+        return;
+    }
+    r->seq = bus[meter].latest.seq + 1;
+    r->time_us = now_us;
+    bus[meter].latest = *r;
+    int32_t value;
+    if (fluke8050_reading_value(r, &value)) {
+        history_push(&bus[meter].history, r->time_us / 1000, value);
+    }
+}
+
+uint8_t fluke8050_bus_meters() { return meters; }
+
+bool fluke8050_bus_latest(uint8_t meter, fluke8050_reading_t *out) {
+    if (meter >= meters || bus[meter].latest.seq == 0) {
+        return false;
+    }
+    *out = bus[meter].latest;
+    return true;
+}
+
+static reading_history_t *history_of(uint8_t meter) {
+    static reading_history_t empty;
+    if (meter >= meters) {
+        return &empty;
+    }
+    return &bus[meter].history;
+}
+
+void fluke8050_bus_history_stats(uint8_t meter, history_stats_t *stats) {
+    *stats = history_of(meter)->stats;
+}
+
+void fluke8050_bus_history_span(uint8_t meter, uint32_t *first,
+                                uint32_t *total) {
+    reading_history_t *h = history_of(meter);
+    *first = history_first(h);
+    *total = h->total;
+}
+
+size_t fluke8050_bus_history_copy(uint8_t meter, uint32_t from,
+                                  history_sample_t *out, size_t max,
+                                  uint32_t *next) {
+    return history_copy(history_of(meter), from, out, max, next);
+}
+
+void fluke8050_bus_history_reset(uint8_t meter) {
+    history_reset(history_of(meter));
+}
+#endif
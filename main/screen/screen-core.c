@@ -1,11 +1,21 @@
 #include "screen-core.h"
 
+#include "display-profile.h"
+#include "fluke8050-bus.h"
+#include "inttypes.h"
+#include "screen-fluke8050.h"
+#include "screen-trend.h"
+
+#ifdef DISPLAY_HOST
+#define panel_flush sim_display_flush
+#else
 #include "driver/ledc.h"
-#include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "lvgl_helpers.h"
 #include "lvgl_tft/st7789.h"
-#include "screen-fluke8050.h"
+#include "screen-diag.h"
+
+#define panel_flush st7789_flush
+#endif
 
 #define TFT_MOSI GPIO_NUM_19
 #define TFT_SCLK GPIO_NUM_18
@@ -14,14 +24,35 @@
 #define TFT_RST GPIO_NUM_23
 #define TFT_BL GPIO_NUM_4
 
-typedef struct screen_data {
-    lv_obj_t *screen;
+typedef void *(*screen_ctor_t)(lv_obj_t *screen, uint8_t arg);
+
+// What a mode's screen is built from. ctor fills in the root object, which
+// comes with the shared style and the display's size, and returns priv; dtor
+// frees priv before the root object and its children are deleted.
+typedef struct screen_spec {
+    screen_ctor_t ctor;
+    tick_callback_t dtor;
     tick_callback_t tick_cb;
     tick_callback_t unload_cb;
     tick_callback_t load_cb;
+    uint8_t arg;
+    bool keep;  // Never destroyed once built
+} screen_spec_t;
+
+typedef struct screen_data {
+    screen_spec_t spec;  // ctor NULL for modes with no screen
+    lv_obj_t *screen;    // NULL until the first show, or after a destroy
     void *priv;
+    uint32_t lv_bytes;    // LVGL pool the last build took
+    uint32_t heap_bytes;  // Heap the last build took
+    int64_t shown_us;     // Last current, so the oldest goes first
 } screen_data_t;
 
+typedef struct screen_request {
+    display_mode_t mode;
+    int64_t queued_us;
+} screen_request_t;
+
 typedef struct display_content_worker_data {
     uint8_t mode;
     QueueHandle_t display_event_queue;
@@ -29,6 +60,10 @@ typedef struct display_content_worker_data {
 
     uint8_t screen_cnt;
     screen_data_t *screen;
+
+    lv_task_t *content_task;
+    volatile bool update_pending;
+    int64_t last_frame_us;
 } display_content_worker_data_t;
 
 typedef struct display_data {
@@ -39,48 +74,443 @@ typedef struct display_data {
 
 static const char *display_tag = "display_tag";
 
-void tick_task(void *arg) { lv_tick_inc(10); }
+static int64_t min_frame_us = 1000000 / 30;
+
+// Source time of data drawn since the last refresh, 0 for none. Set from
+// the display task only, as is latency.
+static int64_t mark_us = 0;
+static display_latency_t latency = {0};
+static display_flush_stats_t flush_stats = {0};
+
+static display_task_stats_t task_stats = {0};
+
+// Built screens other than the current one are kept warm while they cost no
+// more than this, counting LVGL's pool and the heap.
+#define DISPLAY_SCREEN_BUDGET (12 * 1024)
+// Screens the budget would allow are prefetched when the display task is
+// about to sleep at least this long.
+#define DISPLAY_PREFETCH_IDLE_MS 20
+// Warm screens are destroyed rather than build into less of LVGL's pool.
+#define DISPLAY_MIN_LV_FREE (4 * 1024)
+
+static uint32_t screen_budget = DISPLAY_SCREEN_BUDGET;
+static display_screen_stats_t screen_stats = {0};
+
+// The frame being profiled, display task only.
+typedef struct frame_mark {
+    int64_t start_us;  // 0 outside a refresh
+    display_flush_stats_t flush;
+    uint32_t px;  // From display_monitor(), 0 while nothing was drawn
+    uint32_t invalidations;
+    int64_t tick_us;
+} frame_mark_t;
+
+static frame_mark_t frame = {0};
+
+// LVGL's clock, from esp_timer. Only the display task runs LVGL, so it
+// advances the tick itself before each lv_task_handler() instead of a
+// timer interrupting it every millisecond.
+static int64_t tick_us = 0;
+static void display_tick() {
+    int64_t now = esp_timer_get_time();
+    uint32_t ms = (now - tick_us) / 1000;
+    if (ms != 0) {
+        lv_tick_inc(ms);
+        tick_us += ms * 1000LL;
+    }
+}
+
+static uint32_t lv_used() {
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    return mon.total_size - mon.free_size;
+}
+
+static uint32_t lv_free() {
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    return mon.free_size;
+}
+
+// Builds the mode's screen if it isn't already. The heap figure also counts
+// whatever other tasks allocated meanwhile, so it is an estimate.
+static bool build_screen(display_content_worker_data_t *wdata, uint8_t mode) {
+    screen_data_t *sd = &wdata->screen[mode];
+    if (sd->screen != NULL) {
+        return true;
+    }
+    if (sd->spec.ctor == NULL) {
+        return false;
+    }
+    int64_t start = esp_timer_get_time();
+    uint32_t lv_before = lv_used();
+    size_t heap_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+    lv_obj_t *screen = lv_obj_create(NULL, NULL);
+    if (screen == NULL) {
+        ESP_LOGE(display_tag, "No room for screen %u", mode);
+        return false;
+    }
+    lv_obj_add_style(screen, LV_OBJ_PART_MAIN, wdata->my_style);
+    lv_obj_set_size(screen, CONFIG_LV_DISPLAY_WIDTH, CONFIG_LV_DISPLAY_HEIGHT);
+    sd->priv = sd->spec.ctor(screen, sd->spec.arg);
+    sd->screen = screen;
+
+    uint32_t lv_after = lv_used();
+    size_t heap_after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    sd->lv_bytes = lv_after > lv_before ? lv_after - lv_before : 0;
+    sd->heap_bytes = heap_before > heap_after ? heap_before - heap_after : 0;
+    sd->shown_us = esp_timer_get_time();
+    screen_stats.builds++;
+    ESP_LOGI(display_tag,
+             "screen %u built in %" PRId64 " us, %" PRIu32 " B LVGL %" PRIu32
+             " B heap",
+             mode, sd->shown_us - start, sd->lv_bytes, sd->heap_bytes);
+    return true;
+}
+
+static void destroy_screen(display_content_worker_data_t *wdata,
+                           uint8_t mode) {
+    screen_data_t *sd = &wdata->screen[mode];
+    if (sd->spec.dtor != NULL) {
+        sd->spec.dtor(sd->screen, sd->priv);
+    }
+    lv_obj_del(sd->screen);
+    sd->screen = NULL;
+    sd->priv = NULL;
+    screen_stats.destroys++;
+}
+
+// What the warm screens cost, and the one shown longest ago, -1 for none.
+static uint32_t warm_screens(display_content_worker_data_t *wdata,
+                             int *oldest) {
+    uint32_t cost = 0;
+    *oldest = -1;
+    for (int i = 0; i < wdata->screen_cnt; i++) {
+        screen_data_t *sd = &wdata->screen[i];
+        if (i == wdata->mode || sd->screen == NULL || sd->spec.keep) {
+            continue;
+        }
+        cost += sd->lv_bytes + sd->heap_bytes;
+        if (*oldest < 0 || sd->shown_us < wdata->screen[*oldest].shown_us) {
+            *oldest = i;
+        }
+    }
+    return cost;
+}
+
+// Destroys warm screens, oldest first, until the rest fit in budget. Not
+// while a screen load animation may still be drawing the old screen.
+static void trim_screens(display_content_worker_data_t *wdata,
+                         uint32_t budget) {
+    if (lv_anim_count_running() != 0) {
+        return;
+    }
+    int oldest;
+    uint32_t cost;
+    while ((cost = warm_screens(wdata, &oldest)) > budget) {
+        destroy_screen(wdata, oldest);
+    }
+    screen_stats.warm_bytes = cost;
+}
+
+static uint8_t next_mode(display_content_worker_data_t *wdata, uint8_t mode) {
+    for (int i = 1; i <= wdata->screen_cnt; i++) {
+        uint8_t next = (mode + i) % wdata->screen_cnt;
+        if (wdata->screen[next].spec.ctor != NULL) {
+            return next;
+        }
+    }
+    return mode;
+}
+
+// Builds the screen the next button press goes to, if the budget has room
+// for it. A screen's cost is only known once it has been built, so one that
+// didn't fit is not tried again.
+static void prefetch_screen(display_content_worker_data_t *wdata) {
+    uint8_t next = next_mode(wdata, wdata->mode);
+    screen_data_t *sd = &wdata->screen[next];
+    if (sd->screen != NULL || lv_anim_count_running() != 0) {
+        return;
+    }
+    int oldest;
+    uint32_t cost = warm_screens(wdata, &oldest);
+    if (cost + sd->lv_bytes + sd->heap_bytes > screen_budget ||
+        lv_free() < DISPLAY_MIN_LV_FREE) {
+        return;
+    }
+    if (build_screen(wdata, next)) {
+        screen_stats.prefetches++;
+    }
+}
+
+static void switch_screen(display_content_worker_data_t *wdata,
+                          uint8_t new_mode, int64_t queued_us) {
+    screen_data_t *from = &wdata->screen[wdata->mode];
+    screen_data_t *to = &wdata->screen[new_mode];
+    bool cold = to->screen == NULL;
+    if (cold && lv_free() < DISPLAY_MIN_LV_FREE) {
+        trim_screens(wdata, 0);
+    }
+    if (!build_screen(wdata, new_mode)) {
+        return;
+    }
+
+    lv_scr_load_anim_t anim = LV_SCR_LOAD_ANIM_MOVE_RIGHT;
+    if (wdata->mode < new_mode) {
+        anim = LV_SCR_LOAD_ANIM_MOVE_LEFT;
+    }
+
+    lv_scr_load_anim(to->screen, anim, 100, 10, false);
+
+    if (from->spec.unload_cb != NULL) {
+        from->spec.unload_cb(from->screen, from->priv);
+    }
+
+    if (to->spec.load_cb != NULL) {
+        to->spec.load_cb(to->screen, to->priv);
+    }
+
+    int64_t now = esp_timer_get_time();
+    from->shown_us = now;
+    to->shown_us = now;
+    wdata->mode = new_mode;
+
+    int64_t us = now - queued_us;
+    screen_stats.switches++;
+    screen_stats.last_switch_us = us;
+    if (cold) {
+        screen_stats.cold_switches++;
+        if (us > screen_stats.max_cold_us) {
+            screen_stats.max_cold_us = us;
+        }
+    } else if (us > screen_stats.max_warm_us) {
+        screen_stats.max_warm_us = us;
+    }
+    ESP_LOGI(display_tag, "screen %u %s in %" PRId64 " us", new_mode,
+             cold ? "built and loaded" : "loaded", us);
+}
 
 void display_content_worker(lv_task_t *param) {
     display_content_worker_data_t *wdata =
         (display_content_worker_data_t *)param->user_data;
-    display_mode_t new_mode = FLUKE_8050A;
-    if (xQueueReceive(wdata->display_event_queue, &new_mode, 0) == pdTRUE) {
-        if (new_mode != wdata->mode) {
-            lv_scr_load_anim_t anim = LV_SCR_LOAD_ANIM_MOVE_RIGHT;
-            if (wdata->mode < new_mode) {
-                anim = LV_SCR_LOAD_ANIM_MOVE_LEFT;
-            }
-
-            lv_scr_load_anim(wdata->screen[new_mode].screen, anim, 100, 10,
-                             false);
-
-            if (wdata->screen[wdata->mode].unload_cb != NULL) {
-                wdata->screen[wdata->mode].unload_cb(
-                    wdata->screen[wdata->mode].screen,
-                    wdata->screen[wdata->mode].priv);
-            }
-
-            if (wdata->screen[new_mode].load_cb != NULL) {
-                wdata->screen[new_mode].load_cb(wdata->screen[new_mode].screen,
-                                                wdata->screen[new_mode].priv);
-            }
-
-            wdata->mode = new_mode;
+    screen_request_t req;
+    if (xQueueReceive(wdata->display_event_queue, &req, 0) == pdTRUE) {
+        if (req.mode != wdata->mode && req.mode < wdata->screen_cnt &&
+            wdata->screen[req.mode].spec.ctor != NULL) {
+            switch_screen(wdata, req.mode, req.queued_us);
+        }
+    }
+
+    screen_data_t *sd = &wdata->screen[wdata->mode];
+    if (sd->spec.tick_cb != NULL) {
+        int64_t start = esp_timer_get_time();
+        sd->spec.tick_cb(sd->screen, sd->priv);
+        frame.tick_us += esp_timer_get_time() - start;
+    }
+    trim_screens(wdata, screen_budget);
+    profile_overlay_update();
+}
+
+void set_screen_budget(uint32_t bytes) { screen_budget = bytes; }
+
+void display_get_screen_stats(display_screen_stats_t *out) {
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    screen_stats.lv_free = mon.free_size;
+    screen_stats.lv_max_used = mon.max_used;
+    screen_stats.heap_min_free =
+        heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    *out = screen_stats;
+}
+
+void display_mark_update(int64_t source_us) {
+    if (mark_us == 0 || source_us < mark_us) {
+        mark_us = source_us;
+    }
+}
+
+void display_get_latency(display_latency_t *out) { *out = latency; }
+
+void set_max_fps(uint8_t fps) {
+    min_frame_us = fps ? 1000000 / fps : 0;
+}
+
+// LVGL calls this once a refresh has handed its last area to the flush.
+static void display_monitor(lv_disp_drv_t *drv, uint32_t time, uint32_t px) {
+    flush_stats.refreshes++;
+    frame.px = px;
+    if (mark_us == 0) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    latency.last_us = now - mark_us;
+    if (latency.last_us > latency.max_us) {
+        latency.max_us = latency.last_us;
+    }
+    latency.total_us += latency.last_us;
+    latency.frames++;
+    mark_us = 0;
+}
+
+// st7789_flush() queues the area's DMA transfer and returns; the driver
+// calls lv_disp_flush_ready() from the transfer's completion.
+static void display_flush(lv_disp_drv_t *drv, const lv_area_t *area,
+                          lv_color_t *color_map) {
+    int64_t start = esp_timer_get_time();
+    panel_flush(drv, area, color_map);
+    flush_stats.flush_us += esp_timer_get_time() - start;
+    flush_stats.flushes++;
+    flush_stats.bytes += lv_area_get_size(area) * sizeof(lv_color_t);
+}
+
+// LVGL calls this in a loop while it needs a buffer that is still being
+// sent; waiting here instead lets the stall be timed as one.
+static void display_wait(lv_disp_drv_t *drv) {
+    int64_t start = esp_timer_get_time();
+    while (drv->buffer->flushing) {
+    }
+    flush_stats.wait_us += esp_timer_get_time() - start;
+    flush_stats.stalls++;
+}
+
+void display_get_flush_stats(display_flush_stats_t *out) { *out = flush_stats; }
+
+// LVGL's refresh task, paused while there is nothing to redraw, and the
+// priority it runs at otherwise.
+static lv_task_t *refr_task = NULL;
+static uint8_t refr_prio = 0;
+static bool refr_paused = false;
+
+static void refr_pause() {
+    if (!refr_paused) {
+        lv_task_set_prio(refr_task, LV_TASK_PRIO_OFF);
+        refr_paused = true;
+    }
+}
+
+// v7 has no invalidation hook, but rounder_cb sees every invalidated area.
+// It also sees the buffer-sized parts of a refresh, which aren't counted.
+static void display_rounder(lv_disp_drv_t *drv, lv_area_t *area) {
+    if (frame.start_us == 0) {
+        frame.invalidations++;
+        if (refr_paused) {
+            lv_task_set_prio(refr_task, refr_prio);
+            refr_paused = false;
         }
     }
+}
 
-    if (wdata->screen[wdata->mode].tick_cb != NULL) {
-        wdata->screen[wdata->mode].tick_cb(wdata->screen[wdata->mode].screen,
-                                           wdata->screen[wdata->mode].priv);
+static void frame_begin() {
+    frame.start_us = esp_timer_get_time();
+    frame.flush = flush_stats;
+    frame.px = 0;
+}
+
+// Refreshes with nothing to draw aren't frames.
+static void frame_end() {
+    int64_t now = esp_timer_get_time();
+    if (frame.px != 0) {
+        frame_profile_t f = {
+            .end_ms = now / 1000,
+            .frame_us = now - frame.start_us,
+            .flush_us = flush_stats.flush_us - frame.flush.flush_us,
+            .wait_us = flush_stats.wait_us - frame.flush.wait_us,
+            .tick_us = frame.tick_us,
+            .px = frame.px,
+            .invalidations =
+                frame.invalidations > UINT16_MAX ? UINT16_MAX
+                                                 : frame.invalidations,
+            .areas = flush_stats.flushes - frame.flush.flushes};
+        profile_record(&f);
+        frame.tick_us = 0;
+        frame.invalidations = 0;
     }
+    frame.start_us = 0;
+}
+
+// LVGL's periodic refresh, profiled. One that finds nothing to draw pauses
+// the task until display_rounder() sees the next invalidation, so an idle
+// screen doesn't wake the display task every refresh period.
+static void display_refr_task(lv_task_t *task) {
+    frame_begin();
+    _lv_disp_refr_task(task);
+    frame_end();
+    if (frame.px == 0) {
+        refr_pause();
+    }
+}
+
+void display_wake(display_handle_t disp_handle) {
+    display_data_t *ddata = (display_data_t *)disp_handle;
+    ddata->workerdata->update_pending = true;
+    xTaskNotifyGive(ddata->display_task);
+}
+
+// Runs the screen's tick and pushes the result out now rather than on
+// LVGL's next refresh period, no more often than set_max_fps() allows.
+static void display_update(display_content_worker_data_t *dwdata) {
+    int64_t now = esp_timer_get_time();
+    if (now - dwdata->last_frame_us < min_frame_us) {
+        return;
+    }
+    dwdata->update_pending = false;
+    dwdata->last_frame_us = now;
+    display_content_worker(dwdata->content_task);
+    frame_begin();
+    lv_refr_now(NULL);
+    frame_end();
+    // That drew whatever had been invalidated.
+    refr_pause();
 }
 
 void show_display(display_handle_t disp_handle, display_mode_t disp) {
     display_data_t *ddata = (display_data_t *)disp_handle;
-    xQueueSend(ddata->display_event_queue, &disp, pdMS_TO_TICKS(100));
+    screen_request_t req = {.mode = disp, .queued_us = esp_timer_get_time()};
+    xQueueSend(ddata->display_event_queue, &req, pdMS_TO_TICKS(100));
+    display_wake(disp_handle);
 }
 
+void display_get_task_stats(display_task_stats_t *out) { *out = task_stats; }
+
+// Longest the display task sleeps when LVGL has nothing scheduled.
+#define DISPLAY_MAX_SLEEP_MS 1000
+// New data reaches the screens through display_wake(); the content task
+// only polls for what changes with time alone, such as the once a second
+// titles, stats and profiler overlay.
+#define DISPLAY_CONTENT_POLL_MS 1000
+
+// Ticks until LVGL's next task is due, or until a display_wake() held back
+// by set_max_fps() may run, rounded up so the task doesn't wake early to
+// find nothing to do.
+static TickType_t display_sleep(display_content_worker_data_t *dwdata,
+                                uint32_t next_ms) {
+#ifdef DISPLAY_FIXED_POLL
+    // The old loop, to compare wakeups and CPU time against.
+    return pdMS_TO_TICKS(10);
+#endif
+    if (next_ms > DISPLAY_MAX_SLEEP_MS) {
+        next_ms = DISPLAY_MAX_SLEEP_MS;
+    }
+    if (dwdata->update_pending) {
+        int64_t due_us =
+            dwdata->last_frame_us + min_frame_us - esp_timer_get_time();
+        uint32_t due_ms = due_us > 0 ? (due_us + 999) / 1000 : 0;
+        if (due_ms < next_ms) {
+            next_ms = due_ms;
+        }
+    }
+    TickType_t ticks = (next_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+    return ticks != 0 ? ticks : 1;
+}
+
+display_mode_t next_display_mode(display_handle_t disp_handle,
+                                 display_mode_t disp) {
+    display_data_t *ddata = (display_data_t *)disp_handle;
+    return next_mode(ddata->workerdata, disp);
+}
+
+#ifndef DISPLAY_HOST
 static uint16_t brightness = 4096;
 void set_brightness(uint16_t newbrightness) {
     ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, newbrightness);
@@ -88,37 +518,144 @@ void set_brightness(uint16_t newbrightness) {
     brightness = newbrightness;
 }
 uint16_t get_brightness() { return brightness; }
+#endif
+
+// The driver sets its SPI bus up for transfers of at most DISP_BUF_SIZE
+// pixels, so a buffer can't be flushed in one go past that.
+#ifdef DISP_BUF_SIZE
+#define DISPLAY_MAX_LINES (DISP_BUF_SIZE / LV_HOR_RES_MAX)
+#else
+#define DISPLAY_MAX_LINES 40
+#endif
+#define DISPLAY_MIN_LINES 8
+// DMA capable heap left for the SPI driver, WiFi and the rest.
+#define DISPLAY_DMA_RESERVE (16 * 1024)
+
+// Lines per buffer that leave DISPLAY_DMA_RESERVE of the DMA heap free with
+// two buffers allocated.
+static uint16_t display_buffer_lines() {
+    size_t line = LV_HOR_RES_MAX * sizeof(lv_color_t);
+    size_t free = heap_caps_get_free_size(MALLOC_CAP_DMA);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+    size_t each =
+        free > DISPLAY_DMA_RESERVE ? (free - DISPLAY_DMA_RESERVE) / 2 : 0;
+    if (each > largest) {
+        each = largest;
+    }
+    size_t lines = each / line;
+    if (lines > DISPLAY_MAX_LINES) {
+        lines = DISPLAY_MAX_LINES;
+    }
+    return lines < DISPLAY_MIN_LINES ? DISPLAY_MIN_LINES : lines;
+}
 
-void display_worker(void *param) {
-    display_content_worker_data_t *dwdata = param;
+// Falls back to one buffer, with no overlap, rather than none.
+static bool alloc_display_buffers(lv_color_t *buf[2], uint16_t lines) {
+    size_t size = LV_HOR_RES_MAX * lines * sizeof(lv_color_t);
+    buf[0] = heap_caps_malloc(size, MALLOC_CAP_DMA);
+    buf[1] = heap_caps_malloc(size, MALLOC_CAP_DMA);
+    if (buf[0] == NULL) {
+        buf[0] = buf[1];
+        buf[1] = NULL;
+    }
+    return buf[0] != NULL;
+}
 
-    ESP_LOGI(display_tag, "Initializing Display");
-    lv_init();
-    lvgl_driver_init();
+#ifdef DISPLAY_FLUSH_BENCHMARK
+#define FLUSH_BENCH_FRAMES 30
+
+// Full screen redraws with one buffer and then both, so the overlap shows
+// as the difference.
+static void flush_bench_run(lv_disp_buf_t *disp_buf, lv_color_t *buf0,
+                            lv_color_t *buf1, uint32_t size) {
+    while (disp_buf->flushing) {
+    }
+    lv_disp_buf_init(disp_buf, buf0, buf1, size);
+    display_flush_stats_t before = flush_stats;
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < FLUSH_BENCH_FRAMES; i++) {
+        lv_obj_invalidate(lv_scr_act());
+        lv_refr_now(NULL);
+    }
+    while (disp_buf->flushing) {
+    }
+    int64_t us = esp_timer_get_time() - start;
+
+    uint64_t bytes = flush_stats.bytes - before.bytes;
+    int64_t wait_us = flush_stats.wait_us - before.wait_us;
+    int64_t flush_us = flush_stats.flush_us - before.flush_us;
+    ESP_LOGI(display_tag,
+             "flush bench, %s: %" PRId64 ".%01" PRId64 " fps, %" PRIu64
+             " KB/s, render %" PRId64 " us/frame, stalled %" PRId64
+             " us/frame in %" PRIu32 " stalls, flush call %" PRId64
+             " us/frame",
+             buf1 ? "double" : "single",
+             (int64_t)FLUSH_BENCH_FRAMES * 1000000 / us,
+             (int64_t)FLUSH_BENCH_FRAMES * 10000000 / us % 10,
+             bytes * 1000000 / us / 1024,
+             (us - wait_us - flush_us) / FLUSH_BENCH_FRAMES,
+             wait_us / FLUSH_BENCH_FRAMES, flush_stats.stalls - before.stalls,
+             flush_us / FLUSH_BENCH_FRAMES);
+}
+
+static void flush_benchmark(lv_disp_buf_t *disp_buf, lv_color_t *buf[2],
+                            uint16_t lines) {
+    uint32_t size = LV_HOR_RES_MAX * lines;
+    flush_bench_run(disp_buf, buf[0], NULL, size);
+    if (buf[1] != NULL) {
+        flush_bench_run(disp_buf, buf[0], buf[1], size);
+    }
+}
+#endif
+
+// Modes past screen_cnt are left out.
+static void register_screen(display_content_worker_data_t *dwdata,
+                            uint8_t mode, const screen_spec_t *spec) {
+    if (mode < dwdata->screen_cnt) {
+        dwdata->screen[mode].spec = *spec;
+    }
+}
+
+#ifndef DISPLAY_HOST
+static void *diag_screen_ctor(lv_obj_t *screen, uint8_t arg) {
+    return diag_screen_init(screen);
+}
+#endif
 
-#define DISPLAY_BUF_SIZE (LV_HOR_RES_MAX * 40)
+// The driver, the screens and the content task, after lv_init(); everything
+// the display task sets up but the panel and its backlight.
+static void display_start(display_content_worker_data_t *dwdata) {
     ESP_LOGI(display_tag, "Initializing Framebuffers for %ix%i display",
              CONFIG_LV_DISPLAY_WIDTH, CONFIG_LV_DISPLAY_HEIGHT);
 
     static lv_color_t *buf[2];
-    buf[0] = calloc(DISPLAY_BUF_SIZE, sizeof(lv_color_t));
-    buf[1] = calloc(DISPLAY_BUF_SIZE, sizeof(lv_color_t));
-
+    uint16_t lines = display_buffer_lines();
     lv_disp_buf_t *disp_buf = calloc(1, sizeof(lv_disp_buf_t));
-    lv_disp_buf_init(disp_buf, buf[0], buf[1], DISPLAY_BUF_SIZE);
+    if (!alloc_display_buffers(buf, lines) || disp_buf == NULL) {
+        ESP_LOGE(display_tag, "Failed to allocate the framebuffers");
+        vTaskDelay(portMAX_DELAY);
+    }
+    lv_disp_buf_init(disp_buf, buf[0], buf[1], LV_HOR_RES_MAX * lines);
+    flush_stats.buf_lines = lines;
+    flush_stats.buffers = buf[1] != NULL ? 2 : 1;
+    ESP_LOGI(display_tag, "%u buffers of %u lines", flush_stats.buffers,
+             lines);
 
     lv_disp_drv_t *display_drv = calloc(1, sizeof(lv_disp_drv_t));
     lv_disp_drv_init(display_drv);
 
-    display_drv->flush_cb = st7789_flush;
+    display_drv->flush_cb = display_flush;
+    display_drv->wait_cb = display_wait;
+    display_drv->monitor_cb = display_monitor;
+    display_drv->rounder_cb = display_rounder;
     display_drv->buffer = disp_buf;
-    lv_disp_drv_register(display_drv);
+    lv_disp_t *disp = lv_disp_drv_register(display_drv);
+    lv_task_set_cb(disp->refr_task, display_refr_task);
+    refr_task = disp->refr_task;
+    refr_prio = refr_task->prio;
 
-    const esp_timer_create_args_t periodic_timer_args = {
-        .callback = &tick_task, .name = "gui_tick_task"};
-    esp_timer_handle_t periodic_timer;
-    ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, 1000));
+    tick_us = esp_timer_get_time();
 
     dwdata->mode = FLUKE_8050A;
 
@@ -129,46 +666,78 @@ void display_worker(void *param) {
     lv_style_set_text_color(style, LV_STATE_DEFAULT, LV_COLOR_GREEN);
     lv_style_set_bg_color(style, LV_STATE_DEFAULT, LV_COLOR_BLACK);
 
-    lv_obj_t *fluke8050_screen = lv_obj_create(NULL, NULL);
-    lv_obj_add_style(fluke8050_screen, LV_OBJ_PART_MAIN, style);
-    lv_obj_set_size(fluke8050_screen, CONFIG_LV_DISPLAY_WIDTH,
-                    CONFIG_LV_DISPLAY_HEIGHT);
-    dwdata->screen[0].priv = fluke8050_screen_init(fluke8050_screen);
-    dwdata->screen[0].screen = fluke8050_screen;
-    dwdata->screen[0].tick_cb = fluke8050_screen_worker;
+    // Screens are built on first show; the first meter's is kept built.
+    register_screen(dwdata, FLUKE_8050A,
+                    &(screen_spec_t){.ctor = fluke8050_screen_init,
+                                     .dtor = fluke8050_screen_free,
+                                     .tick_cb = fluke8050_screen_worker,
+                                     .keep = true});
+
+    // One screen per further meter; modes without a meter stay empty.
+    uint8_t meters = fluke8050_bus_meters();
+    for (int m = 1; m < meters && FLUKE_8050A + m <= FLUKE_8050A_4; m++) {
+        register_screen(dwdata, FLUKE_8050A + m,
+                        &(screen_spec_t){.ctor = fluke8050_screen_init,
+                                         .dtor = fluke8050_screen_free,
+                                         .tick_cb = fluke8050_screen_worker,
+                                         .arg = m});
+    }
 
+    register_screen(dwdata, FLUKE_8050A_SEG7,
+                    &(screen_spec_t){.ctor = fluke8050_seg7_screen_init,
+                                     .dtor = fluke8050_screen_free,
+                                     .tick_cb = fluke8050_screen_worker});
+
+    register_screen(dwdata, TREND,
+                    &(screen_spec_t){.ctor = trend_screen_init,
+                                     .dtor = trend_screen_free,
+                                     .tick_cb = trend_screen_worker,
+                                     .load_cb = trend_screen_load,
+                                     .unload_cb = trend_screen_unload});
+
+#ifndef DISPLAY_HOST
+    register_screen(dwdata, DIAGNOSTICS,
+                    &(screen_spec_t){.ctor = diag_screen_ctor,
+                                     .dtor = diag_screen_free,
+                                     .tick_cb = diag_screen_worker});
+#endif
+
+    if (!build_screen(dwdata, dwdata->mode)) {
+        ESP_LOGE(display_tag, "Failed to build the first screen");
+        vTaskDelay(portMAX_DELAY);
+    }
     lv_scr_load(dwdata->screen[0].screen);
-    lv_task_t *task =
-        lv_task_create(display_content_worker, 100, LV_TASK_PRIO_LOW, dwdata);
-
-    ledc_timer_config_t ledc_timer = {.speed_mode = LEDC_LOW_SPEED_MODE,
-                                      .timer_num = LEDC_TIMER_0,
-                                      .duty_resolution = LEDC_TIMER_13_BIT,
-                                      .freq_hz = 1000,
-                                      .clk_cfg = LEDC_AUTO_CLK};
-    ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
-
-    ledc_channel_config_t bl_pwm = {.speed_mode = LEDC_LOW_SPEED_MODE,
-                                    .channel = LEDC_CHANNEL_0,
-                                    .intr_type = LEDC_INTR_DISABLE,
-                                    .timer_sel = LEDC_TIMER_0,
-                                    .gpio_num = TFT_BL,
-                                    .duty = 0,
-                                    .hpoint = 0};
-
-    ESP_ERROR_CHECK(ledc_channel_config(&bl_pwm));
-
-    set_brightness(brightness);
+#ifdef DISPLAY_FLUSH_BENCHMARK
+    flush_benchmark(disp_buf, buf, lines);
+#endif
+    dwdata->content_task =
+        lv_task_create(display_content_worker, DISPLAY_CONTENT_POLL_MS,
+                       LV_TASK_PRIO_LOW, dwdata);
+}
 
-    while (true) {
-        vTaskDelay(pdMS_TO_TICKS(10));
-        lv_task_handler();
+// One pass of the display task: LVGL's clock, a display_wake() update and
+// LVGL's tasks that are due, then a prefetch if there is time. Returns how
+// long the task may sleep.
+static TickType_t display_step(display_content_worker_data_t *dwdata) {
+    int64_t start = esp_timer_get_time();
+    task_stats.wakeups++;
+    display_tick();
+    if (dwdata->update_pending) {
+        display_update(dwdata);
     }
-
-    lv_task_del(task);
+    TickType_t sleep = display_sleep(dwdata, lv_task_handler());
+    if (!dwdata->update_pending &&
+        sleep * portTICK_PERIOD_MS >= DISPLAY_PREFETCH_IDLE_MS) {
+        prefetch_screen(dwdata);
+    }
+    int64_t busy_us = esp_timer_get_time() - start;
+    task_stats.busy_us += busy_us;
+    profile_handler_done(busy_us);
+    return sleep;
 }
 
-display_handle_t init_display(int screen_count) {
+// Everything but the display task, which init_display() starts.
+static display_data_t *display_alloc(int screen_count) {
     display_content_worker_data_t *dwdata =
         calloc(1, sizeof(display_content_worker_data_t));
     if (dwdata == NULL) {
@@ -176,7 +745,7 @@ display_handle_t init_display(int screen_count) {
         vTaskDelay(portMAX_DELAY);
     }
 
-    dwdata->display_event_queue = xQueueCreate(10, sizeof(display_mode_t));
+    dwdata->display_event_queue = xQueueCreate(10, sizeof(screen_request_t));
     if (dwdata->display_event_queue == NULL) {
         ESP_LOGE(display_tag, "Failed to create display_event_queue");
         vTaskDelay(portMAX_DELAY);
@@ -199,12 +768,71 @@ display_handle_t init_display(int screen_count) {
         vTaskDelay(portMAX_DELAY);
     }
 
-    BaseType_t ret = xTaskCreate(&display_worker, display_tag, 4 * 1024, dwdata,
-                                 3, &ddata->display_task);
+    return ddata;
+}
+
+#ifdef DISPLAY_HOST
+display_handle_t display_host_start(int screen_count) {
+    display_data_t *ddata = display_alloc(screen_count);
+    display_start(ddata->workerdata);
+    return ddata;
+}
+
+void display_host_step(display_handle_t disp_handle) {
+    display_data_t *ddata = (display_data_t *)disp_handle;
+    display_step(ddata->workerdata);
+}
+#else
+void display_worker(void *param) {
+    display_content_worker_data_t *dwdata = param;
+
+    ESP_LOGI(display_tag, "Initializing Display");
+    lv_init();
+    lvgl_driver_init();
+    display_start(dwdata);
+
+    ledc_timer_config_t ledc_timer = {.speed_mode = LEDC_LOW_SPEED_MODE,
+                                      .timer_num = LEDC_TIMER_0,
+                                      .duty_resolution = LEDC_TIMER_13_BIT,
+                                      .freq_hz = 1000,
+                                      .clk_cfg = LEDC_AUTO_CLK};
+    ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
+
+    ledc_channel_config_t bl_pwm = {.speed_mode = LEDC_LOW_SPEED_MODE,
+                                    .channel = LEDC_CHANNEL_0,
+                                    .intr_type = LEDC_INTR_DISABLE,
+                                    .timer_sel = LEDC_TIMER_0,
+                                    .gpio_num = TFT_BL,
+                                    .duty = 0,
+                                    .hpoint = 0};
+
+    ESP_ERROR_CHECK(ledc_channel_config(&bl_pwm));
+
+    set_brightness(brightness);
+
+    // Sleeps until LVGL's next deadline or a display_wake(); screens only
+    // change from LVGL tasks or display_update(), so nothing can need a
+    // refresh in between.
+    TickType_t sleep = 1;
+    while (true) {
+        if (ulTaskNotifyTake(pdTRUE, sleep) != 0) {
+            task_stats.notified++;
+        }
+        sleep = display_step(dwdata);
+    }
+
+    lv_task_del(dwdata->content_task);
+}
+
+display_handle_t init_display(int screen_count) {
+    display_data_t *ddata = display_alloc(screen_count);
+    BaseType_t ret = xTaskCreate(&display_worker, display_tag, 4 * 1024,
+                                 ddata->workerdata, 3, &ddata->display_task);
     if (ret != pdTRUE) {
         ESP_LOGE(display_tag, "Failed to create the display_task");
         vTaskDelay(portMAX_DELAY);
     }
 
     return ddata;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,199 @@
+#include "screen-diag.h"
+
+#include "esp32-cpu1.h"
+#include "esp_timer.h"
+#include "fluke8050-bus.h"
+#include "inttypes.h"
+#include "screen-core.h"
+
+// Sequencer diagnostics: page rate, period spread and the period histogram
+// since the previous refresh, so a change in output timing shows up without
+// a logic analyzer. Each refresh is also logged to the console.
+typedef struct diag_data {
+    int64_t last_call_s;
+    int64_t last_us;
+    cpu1_stats_t last;
+    display_task_stats_t last_task;
+
+    lv_obj_t *window;
+
+    lv_obj_t *title;
+    lv_obj_t *rate;
+    lv_obj_t *period;
+    lv_obj_t *events;
+
+    lv_obj_t *hist;
+    lv_chart_series_t *hist_series;
+} diag_data_t;
+
+static void draw_diag(diag_data_t *pdata, const cpu1_stats_t *st,
+                      int64_t now_us) {
+    char buff[48];
+
+    uint32_t pages = st->pages - pdata->last.pages;
+    uint32_t rate = 0;
+    if (now_us > pdata->last_us) {
+        rate = (uint64_t)pages * 1000000ULL / (now_us - pdata->last_us);
+    }
+    snprintf(buff, sizeof(buff), "bank %u  %" PRIu32 " pages/s",
+             st->active_bank, rate);
+    lv_label_set_text(pdata->rate, buff);
+
+    uint32_t periods = st->periods - pdata->last.periods;
+    uint32_t avg = 0;
+    if (periods != 0) {
+        avg = (st->period_total - pdata->last.period_total) / periods;
+    }
+    snprintf(buff, sizeof(buff), "period %" PRIu32 "/%" PRIu32 "/%" PRIu32,
+             st->period_min, avg, st->period_max);
+    lv_label_set_text(pdata->period, buff);
+
+    snprintf(buff, sizeof(buff),
+             "swap %" PRIu32 " stall %" PRIu32 " late %" PRIu32,
+             st->bank_switches, st->stalls, st->timed_late_pages);
+    lv_label_set_text(pdata->events, buff);
+
+    // Share of this interval's periods in each bucket, in percent.
+    lv_coord_t points[CPU1_HIST_BUCKETS];
+    for (int i = 0; i < CPU1_HIST_BUCKETS; i++) {
+        uint32_t n = st->period_hist[i] - pdata->last.period_hist[i];
+        points[i] = periods ? (uint64_t)n * 100 / periods : 0;
+    }
+    lv_chart_set_points(pdata->hist, pdata->hist_series, points);
+    lv_chart_refresh(pdata->hist);
+}
+
+void diag_screen_worker(lv_obj_t *screen, void *priv) {
+    diag_data_t *pdata = priv;
+    int64_t now_us = esp_timer_get_time();
+    int64_t new_call_s = now_us / 1000000LL;
+    if (new_call_s == pdata->last_call_s) {
+        return;
+    }
+    pdata->last_call_s = new_call_s;
+
+    // Shows the read queued a refresh ago and queues the next, so the LVGL
+    // task never waits on the APP cpu or hands it a buffer of its own.
+    cpu1_stats_t st;
+    bool answered = cpu1_fetch_stats(&st);
+    cpu1_request_stats();
+    if (!answered) {
+        lv_label_set_text(pdata->rate, "APP cpu not answering");
+        return;
+    }
+    draw_diag(pdata, &st, now_us);
+    cpu1_print_stats(&st);
+
+    for (uint8_t id = 0; id < fluke8050_bus_meters(); id++) {
+        fluke8050_bus_stats_t bs;
+        fluke8050_bus_get_stats(id, &bs);
+        printf("fluke8050: meter %u %" PRIu32 " scans/s, %" PRIu32
+               " samples/s all meters, %" PRIu32 " torn, %" PRIu32
+               " overflows\n",
+               id, bs.scan_rate, bs.sample_rate, bs.torn, bs.overflows);
+    }
+
+    display_latency_t lat;
+    display_get_latency(&lat);
+    if (lat.frames != 0) {
+        printf("display: latency %" PRId64 "/%" PRId64 "/%" PRId64
+               " us over %" PRIu32 " frames\n",
+               lat.last_us, lat.total_us / lat.frames, lat.max_us, lat.frames);
+    }
+
+    display_flush_stats_t fl;
+    display_get_flush_stats(&fl);
+    if (fl.flushes != 0) {
+        printf("display: %ux%u lines, %" PRIu32 " flushes, %" PRId64
+               " us to queue, %" PRIu32 " stalls, %" PRId64 " us waited\n",
+               fl.buffers, fl.buf_lines, fl.flushes,
+               fl.flush_us / fl.flushes, fl.stalls, fl.wait_us);
+    }
+
+    // The display task's share of CPU0 since the last refresh.
+    display_task_stats_t task;
+    display_get_task_stats(&task);
+    int64_t span_us = now_us - pdata->last_us;
+    if (span_us > 0) {
+        int64_t busy_us = task.busy_us - pdata->last_task.busy_us;
+        printf("display: %" PRIu32 " wakeups (%" PRIu32
+               " woken), %" PRId64 " us busy, %" PRId64 ".%01" PRId64
+               "%% of CPU0 over %" PRId64 " ms\n",
+               task.wakeups - pdata->last_task.wakeups,
+               task.notified - pdata->last_task.notified, busy_us,
+               busy_us * 100 / span_us, busy_us * 1000 / span_us % 10,
+               span_us / 1000);
+    }
+
+    display_screen_stats_t scr;
+    display_get_screen_stats(&scr);
+    printf("display: %" PRIu32 " switches (%" PRIu32 " cold), last %" PRId64
+           " us, worst %" PRId64 "/%" PRId64 " us cold/warm\n",
+           scr.switches, scr.cold_switches, scr.last_switch_us,
+           scr.max_cold_us, scr.max_warm_us);
+    printf("display: screens %" PRIu32 " built (%" PRIu32
+           " prefetched) %" PRIu32 " destroyed, %" PRIu32
+           " B warm; LVGL %" PRIu32 " B free %" PRIu32
+           " B peak, heap %" PRIu32 " B low\n",
+           scr.builds, scr.prefetches, scr.destroys, scr.warm_bytes,
+           scr.lv_free, scr.lv_max_used, scr.heap_min_free);
+
+    pdata->last = st;
+    pdata->last_task = task;
+    pdata->last_us = now_us;
+}
+
+#define CREATE_INIT(A, B, X, Y) \
+    X = lv_label_create(A, B);  \
+    lv_label_set_text(X, Y);    \
+    lv_label_set_recolor(X, true);
+
+void *diag_screen_init(lv_obj_t *screen) {
+    diag_data_t *priv = calloc(1, sizeof(diag_data_t));
+    priv->window = screen;
+    priv->last_us = esp_timer_get_time();
+    cpu1_request_stats();
+
+    lv_coord_t swidth = lv_obj_get_width(priv->window);
+    lv_coord_t sheight = lv_obj_get_height(priv->window);
+
+    // Kept for the next build of the screen.
+    static bool text_style_ready = false;
+    static lv_style_t text_style;
+    if (!text_style_ready) {
+        lv_style_init(&text_style);
+        lv_style_set_text_font(&text_style, LV_STATE_DEFAULT,
+                               &lv_font_montserrat_12);
+        text_style_ready = true;
+    }
+
+    CREATE_INIT(priv->window, NULL, priv->title, "Sequencer");
+    lv_obj_add_style(priv->title, LV_LABEL_PART_MAIN, &text_style);
+    lv_obj_set_pos(priv->title, swidth / 2 - lv_obj_get_width(priv->title) / 2,
+                   0);
+
+    CREATE_INIT(priv->window, NULL, priv->rate, "");
+    lv_obj_add_style(priv->rate, LV_LABEL_PART_MAIN, &text_style);
+    lv_obj_set_pos(priv->rate, 0, 14);
+
+    CREATE_INIT(priv->window, NULL, priv->period, "");
+    lv_obj_add_style(priv->period, LV_LABEL_PART_MAIN, &text_style);
+    lv_obj_set_pos(priv->period, 0, 28);
+
+    CREATE_INIT(priv->window, NULL, priv->events, "");
+    lv_obj_add_style(priv->events, LV_LABEL_PART_MAIN, &text_style);
+    lv_obj_set_pos(priv->events, 0, 42);
+
+    priv->hist = lv_chart_create(priv->window, NULL);
+    lv_obj_set_pos(priv->hist, 0, 58);
+    lv_obj_set_size(priv->hist, swidth, sheight - 58);
+    lv_chart_set_type(priv->hist, LV_CHART_TYPE_COLUMN);
+    lv_chart_set_point_count(priv->hist, CPU1_HIST_BUCKETS);
+    lv_chart_set_y_range(priv->hist, LV_CHART_AXIS_PRIMARY_Y, 0, 100);
+    lv_chart_set_div_line_count(priv->hist, 0, 0);
+    priv->hist_series = lv_chart_add_series(priv->hist, LV_COLOR_GREEN);
+    lv_chart_init_points(priv->hist, priv->hist_series, 0);
+    return priv;
+}
+
+void diag_screen_free(lv_obj_t *screen, void *priv) { free(priv); }
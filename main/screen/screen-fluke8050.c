@@ -1,65 +1,34 @@
 #include "screen-fluke8050.h"
 
+#include "display-port.h"
 #include "esp32-cpu1.h"
-#include "esp_timer.h"
+#include "fluke8050-bus.h"
+#include "fluke8050-decoder.h"
+#include "fluke8050-derived.h"
 #include "inttypes.h"
-
-#ifndef BIT
-#define BIT(X) (1 << X)
-#endif
-
-// U10
-typedef enum indicators {
-    IND_REL = BIT(0),
-    IND_BAT = BIT(1),
-    IND_HV = BIT(2),
-    IND_DB = BIT(3)
-} indicators_t;
-
-// U11
-typedef enum sign {
-    SIGN_PLUS = BIT(0),
-    SIGN_MINUS = BIT(1),
-    SIGN_ONE = BIT(2),
-    SIGN_BP = BIT(3)  // Blanking Period for LCD, Always Set.
-} sign_t;
-
-// U12-U15
-typedef enum digit {
-    CD4056_0 = 0,
-    CD4056_1 = 1,
-    CD4056_2 = 2,
-    CD4056_3 = 3,
-    CD4056_4 = 4,
-    CD4056_5 = 5,
-    CD4056_6 = 6,
-    CD4056_7 = 7,
-    CD4056_8 = 8,
-    CD4056_9 = 9,
-    CD4056_L = 10,
-    CD4056_H = 11,
-    CD4056_P = 12,
-    CD4056_A = 13,
-    CD4056_DASH = 14,
-    CD4056_OFF = 15
-} digit_t;
-
-// U16
-typedef enum decimals {
-    D0 = BIT(0),
-    D1 = BIT(1),
-    D2 = BIT(2),
-    D3 = BIT(3)
-} decimals_t;
+#include "screen-core.h"
+#include "string.h"
+#include "widget-seg7.h"
 
 typedef struct fluke8050_data {
-    indicators_t indicator_mask;
-    sign_t sign_mask;
-    decimals_t decimal_mask;
-
-    digit_t digits[4];
+    uint8_t meter;
+    fluke8050_reading_t reading;  // What the labels show, once drawn is set
+    bool drawn;
     uint16_t call_cnt;
+
+    // Label updates done and avoided by diffing against reading.
+    uint32_t readings;
+    uint32_t labels_set;
+    uint32_t labels_skipped;
+    uint32_t bytes_saved;
+#ifdef FLUKE8050_DRAW_BENCHMARK
+    // Per reading: updating the objects, then LVGL rendering and flushing.
+    uint64_t update_us;
+    uint64_t refresh_us;
+    uint32_t refresh_max_us;
+#endif
     int64_t last_call_s;
+    uint32_t stats_count;  // History count the stats label shows
 
     lv_obj_t *window;
 
@@ -70,18 +39,47 @@ typedef struct fluke8050_data {
     lv_obj_t *ind_hv;
     lv_obj_t *ind_db;
 
+    lv_obj_t *stats;
+    lv_obj_t *derived;
+    uint32_t derived_gen;  // derived_gen the label was drawn for
+    bool derived_ok;
+    int32_t derived_value;
+
     lv_obj_t *sign;  // Plus or minus
     lv_obj_t *one;   // 1 or 1. or empty
 
     lv_obj_t *figs[4];
+
+    // Seven segment view: sign, leading one and the four digits, in place
+    // of the labels above.
+    lv_obj_t *seg7;
 } fluke8050_data_t;
 
+static const char *TAG = "fluke8050";
+
+// Derived reading per meter, kept across screen changes and shared by both
+// views. Buttons only post requests; the display task applies them to the
+// meter on screen so each engine has a single user.
+static derived_t derived[FLUKE8050_MAX_METERS];
+static uint32_t derived_gen[FLUKE8050_MAX_METERS];  // Bumped on each change
+static volatile uint32_t mode_requests = 0;
+static volatile uint32_t param_requests = 0;
+static uint32_t modes_applied = 0;
+static uint32_t params_applied = 0;
+static uint32_t derived_cycles = 0;
+static uint32_t derived_count = 0;
+
 static uint32_t last = 0;
 void draw_fluke8050_title(fluke8050_data_t *data) {
     uint32_t now = cpu1_counter;
     lv_point_t p;
     char uptime[26] = "Fluke 8050a 9223372036854 ";
-    snprintf(uptime, strlen(uptime), "Fluke 8050a %" PRId32, now - last);
+    if (fluke8050_bus_meters() > 1) {
+        snprintf(uptime, strlen(uptime), "8050a #%u %" PRId32,
+                 data->meter + 1, now - last);
+    } else {
+        snprintf(uptime, strlen(uptime), "Fluke 8050a %" PRId32, now - last);
+    }
     last = now;
 
     _lv_txt_get_size(&p, uptime, &lv_font_montserrat_12, 0, 0, LV_COORD_MAX,
@@ -93,8 +91,6 @@ void draw_fluke8050_title(fluke8050_data_t *data) {
     lv_label_set_text(data->title, uptime);
 }
 
-#define get_nibble(A, B) (A & (0x0f << B)) >> B
-
 void draw_text_with_flag(lv_obj_t *o, uint8_t flags, uint8_t flag, char *text) {
     if (flags & flag) {
         lv_label_set_text(o, text);
@@ -105,113 +101,330 @@ void draw_text_with_flag(lv_obj_t *o, uint8_t flags, uint8_t flag, char *text) {
     }
 }
 
+// CD4056 BCD inputs to what the segments show.
+static const char cd4056_glyph[16] = {
+    [CD4056_0] = '0',    [CD4056_1] = '1', [CD4056_2] = '2',
+    [CD4056_3] = '3',    [CD4056_4] = '4', [CD4056_5] = '5',
+    [CD4056_6] = '6',    [CD4056_7] = '7', [CD4056_8] = '8',
+    [CD4056_9] = '9',    [CD4056_L] = 'L', [CD4056_H] = 'H',
+    [CD4056_P] = 'P',    [CD4056_A] = 'A', [CD4056_DASH] = '-',
+    [CD4056_OFF] = ' '};
+
 void draw_digit(lv_obj_t *o, uint8_t digit, bool dp) {
     char txt[3] = "  ";
     if (dp) {
         txt[0] = '.';
     }
-    switch (digit) {
-        case CD4056_0:
-            txt[1] = '0';
-            break;
-        case CD4056_1:
-            txt[1] = '1';
-            break;
-        case CD4056_2:
-            txt[1] = '2';
-            break;
-        case CD4056_3:
-            txt[1] = '3';
-            break;
-        case CD4056_4:
-            txt[1] = '4';
-            break;
-        case CD4056_5:
-            txt[1] = '5';
-            break;
-        case CD4056_6:
-            txt[1] = '6';
-            break;
-        case CD4056_7:
-            txt[1] = '7';
-            break;
-        case CD4056_8:
-            txt[1] = '8';
-            break;
-        case CD4056_9:
-            txt[1] = '9';
-            break;
-        case CD4056_L:
-            txt[1] = 'L';
-            break;
-        case CD4056_H:
-            txt[1] = 'H';
-            break;
-        case CD4056_P:
-            txt[1] = 'P';
-            break;
-        case CD4056_A:
-            txt[1] = 'A';
-            break;
-        case CD4056_DASH:
-            txt[1] = '-';
-            break;
-        case CD4056_OFF:
-            txt[1] = ' ';
-            break;
-    }
+    txt[1] = cd4056_glyph[digit & 0x0f];
     lv_label_set_text(o, txt);
 }
 
-void fluke8050_screen_worker(lv_obj_t *screen, void *priv) {
-    fluke8050_data_t *pdata = priv;
-    int64_t new_call_ms = esp_timer_get_time() / 1000LL;
-    int64_t new_call_s = new_call_ms / 1000;
-    if (new_call_s != pdata->last_call_s) {
-        draw_fluke8050_title(pdata);
+// Statistics of every numeric reading since the history was last reset,
+// from the bus task's history.
+static void draw_stats(fluke8050_data_t *pdata) {
+    history_stats_t st;
+    fluke8050_bus_history_stats(pdata->meter, &st);
+    if (st.count == pdata->stats_count) {
+        return;
+    }
+    pdata->stats_count = st.count;
+
+    char buff[96];
+    if (st.count == 0) {
+        snprintf(buff, sizeof(buff), "no readings");
+    } else {
+        char min[16], max[16], avg[16], sd[16] = "--";
+        fluke8050_format_value(st.min, min, sizeof(min));
+        fluke8050_format_value(st.max, max, sizeof(max));
+        fluke8050_format_value(history_mean(&st), avg, sizeof(avg));
+        int32_t dev = history_stddev(&st);
+        if (dev >= 0) {
+            fluke8050_format_value(dev, sd, sizeof(sd));
+        }
+        snprintf(buff, sizeof(buff),
+                 "min %s  max %s\n"
+                 "avg %s  sd %s  n %" PRIu32,
+                 min, max, avg, sd, st.count);
+    }
+    lv_label_set_text(pdata->stats, buff);
+}
 
-        // update output state
+// Counts a label that was redrawn, or left alone and the bytes its area
+// would have cost to flush.
+static void count_label(fluke8050_data_t *pdata, lv_obj_t *o, bool drawn) {
+    if (drawn) {
+        pdata->labels_set++;
+        return;
+    }
+    pdata->labels_skipped++;
+    pdata->bytes_saved += (uint32_t)lv_obj_get_width(o) *
+                          lv_obj_get_height(o) * sizeof(lv_color_t);
+}
 
-        pdata->indicator_mask = get_nibble(new_call_s, 0);
-        draw_text_with_flag(pdata->ind_bat, pdata->indicator_mask, IND_BAT,
-                            "BT");
-        draw_text_with_flag(pdata->ind_db, pdata->indicator_mask, IND_DB, "DB");
-        draw_text_with_flag(pdata->ind_hv, pdata->indicator_mask, IND_HV, "HV");
-        draw_text_with_flag(pdata->ind_rel, pdata->indicator_mask, IND_REL,
-                            "REL");
+static void draw_indicator(fluke8050_data_t *pdata, lv_obj_t *o,
+                           uint8_t changed, uint8_t flags, uint8_t flag,
+                           char *text) {
+    if (changed & flag) {
+        draw_text_with_flag(o, flags, flag, text);
+    }
+    count_label(pdata, o, changed & flag);
+}
 
-        pdata->sign_mask = get_nibble(new_call_s, 0);
-        pdata->sign_mask |= SIGN_BP;
-        if (pdata->sign_mask & SIGN_PLUS) {
+static void draw_number(fluke8050_data_t *pdata, const fluke8050_reading_t *r,
+                        bool all) {
+    const fluke8050_reading_t *old = &pdata->reading;
+    uint8_t sign = all ? 0x0f : r->sign_mask ^ old->sign_mask;
+    bool draw = sign & (SIGN_PLUS | SIGN_MINUS);
+    if (draw) {
+        if (r->sign_mask & SIGN_PLUS) {
             lv_label_set_text(pdata->sign, "+");
-        } else if (pdata->sign_mask & SIGN_MINUS) {
+        } else if (r->sign_mask & SIGN_MINUS) {
             lv_label_set_text(pdata->sign, "-");
         } else {
             lv_label_set_text(pdata->sign, " ");
         }
+    }
+    count_label(pdata, pdata->sign, draw);
 
-        if (pdata->sign_mask & SIGN_ONE) {
+    draw = sign & SIGN_ONE;
+    if (draw) {
+        if (r->sign_mask & SIGN_ONE) {
             lv_label_set_text(pdata->one, "1");
         } else {
             lv_label_set_text(pdata->one, "  ");
         }
+    }
+    count_label(pdata, pdata->one, draw);
+
+    uint8_t dp = all ? 0x0f : r->decimal_mask ^ old->decimal_mask;
+    for (int i = 0; i < 4; i++) {
+        draw = (dp & BIT(i)) || all || r->digits[i] != old->digits[i];
+        if (draw) {
+            draw_digit(pdata->figs[i], r->digits[i], r->decimal_mask & BIT(i));
+        }
+        count_label(pdata, pdata->figs[i], draw);
+    }
+}
+
+// CD4056 BCD inputs to segments, matching cd4056_glyph.
+static const uint8_t cd4056_segs[16] = {
+    [CD4056_0] = SEG7_A | SEG7_B | SEG7_C | SEG7_D | SEG7_E | SEG7_F,
+    [CD4056_1] = SEG7_B | SEG7_C,
+    [CD4056_2] = SEG7_A | SEG7_B | SEG7_D | SEG7_E | SEG7_G,
+    [CD4056_3] = SEG7_A | SEG7_B | SEG7_C | SEG7_D | SEG7_G,
+    [CD4056_4] = SEG7_B | SEG7_C | SEG7_F | SEG7_G,
+    [CD4056_5] = SEG7_A | SEG7_C | SEG7_D | SEG7_F | SEG7_G,
+    [CD4056_6] = SEG7_A | SEG7_C | SEG7_D | SEG7_E | SEG7_F | SEG7_G,
+    [CD4056_7] = SEG7_A | SEG7_B | SEG7_C,
+    [CD4056_8] = SEG7_A | SEG7_B | SEG7_C | SEG7_D | SEG7_E | SEG7_F | SEG7_G,
+    [CD4056_9] = SEG7_A | SEG7_B | SEG7_C | SEG7_D | SEG7_F | SEG7_G,
+    [CD4056_L] = SEG7_D | SEG7_E | SEG7_F,
+    [CD4056_H] = SEG7_B | SEG7_C | SEG7_E | SEG7_F | SEG7_G,
+    [CD4056_P] = SEG7_A | SEG7_B | SEG7_E | SEG7_F | SEG7_G,
+    [CD4056_A] = SEG7_A | SEG7_B | SEG7_C | SEG7_E | SEG7_F | SEG7_G,
+    [CD4056_DASH] = SEG7_G,
+    [CD4056_OFF] = 0};
+
+// The widget does its own diffing down to single segments.
+static void draw_segments(fluke8050_data_t *pdata,
+                          const fluke8050_reading_t *r) {
+    uint16_t sign = 0;
+    if (r->sign_mask & SIGN_PLUS) {
+        sign = SEG7_G | SEG7_BAR;
+    } else if (r->sign_mask & SIGN_MINUS) {
+        sign = SEG7_G;
+    }
+    seg7_set_cell(pdata->seg7, 0, sign);
+    seg7_set_cell(pdata->seg7, 1,
+                  r->sign_mask & SIGN_ONE ? SEG7_B | SEG7_C : 0);
+    for (int i = 0; i < 4; i++) {
+        uint16_t segs = cd4056_segs[r->digits[i] & 0x0f];
+        if (r->decimal_mask & BIT(i)) {
+            segs |= SEG7_DP;
+        }
+        seg7_set_cell(pdata->seg7, 2 + i, segs);
+    }
+}
+
+void fluke8050_derived_next_mode() { mode_requests++; }
+
+void fluke8050_derived_next_param() { param_requests++; }
+
+static void apply_derived_requests(uint8_t meter, int32_t current) {
+    derived_t *d = &derived[meter];
+    while (modes_applied != mode_requests) {
+        modes_applied++;
+        derived_set_mode(d, (d->mode + 1) % DERIVED_MODES, current);
+        derived_gen[meter]++;
+    }
+    while (params_applied != param_requests) {
+        params_applied++;
+        derived_next_param(d, current);
+        derived_gen[meter]++;
+    }
+}
+
+// Only relabels when the result or the setting changed.
+static void draw_derived(fluke8050_data_t *pdata,
+                         const fluke8050_reading_t *r) {
+    derived_t *d = &derived[pdata->meter];
+    int32_t value;
+    bool numeric = fluke8050_reading_value(r, &value);
+    if (numeric) {
+        apply_derived_requests(pdata->meter, value);
+    }
+
+    int32_t out = 0;
+    bool ok = false;
+    if (numeric) {
+        uint32_t start = XTHAL_GET_CCOUNT();
+        ok = derived_apply(d, value, &out);
+        derived_cycles += XTHAL_GET_CCOUNT() - start;
+        derived_count++;
+    }
 
-        pdata->decimal_mask = get_nibble(new_call_s, 0);
+    uint32_t gen = derived_gen[pdata->meter];
+    if (pdata->derived_gen == gen && pdata->derived_ok == ok &&
+        pdata->derived_value == out) {
+        return;
+    }
+    pdata->derived_gen = gen;
+    pdata->derived_ok = ok;
+    pdata->derived_value = out;
+
+    char desc[24];
+    char buff[48];
+    derived_describe(d, desc, sizeof(desc));
+    if (d->mode == DERIVED_OFF) {
+        buff[0] = 0;
+    } else if (ok) {
+        char num[16];
+        fluke8050_format_value(out, num, sizeof(num));
+        snprintf(buff, sizeof(buff), "%s  %s", desc, num);
+    } else {
+        snprintf(buff, sizeof(buff), "%s  ----", desc);
+    }
+    lv_label_set_text(pdata->derived, buff);
+}
 
-        pdata->digits[0] = get_nibble(new_call_s, 0);
-        draw_digit(pdata->figs[0], pdata->digits[0], pdata->decimal_mask & D0);
+// Only objects whose field differs from what is on screen are touched;
+// each lv_label_set_text() re-lays the label out and invalidates its area
+// even when the text is the same.
+static void draw_reading(fluke8050_data_t *pdata,
+                         const fluke8050_reading_t *r) {
+    const fluke8050_reading_t *old = &pdata->reading;
+    bool all = !pdata->drawn;
+    uint32_t set = pdata->labels_set;
+    uint32_t saved = pdata->bytes_saved;
+
+    uint8_t ind = all ? 0x0f : r->indicator_mask ^ old->indicator_mask;
+    draw_indicator(pdata, pdata->ind_bat, ind, r->indicator_mask, IND_BAT,
+                   "BT");
+    draw_indicator(pdata, pdata->ind_db, ind, r->indicator_mask, IND_DB, "DB");
+    draw_indicator(pdata, pdata->ind_hv, ind, r->indicator_mask, IND_HV, "HV");
+    draw_indicator(pdata, pdata->ind_rel, ind, r->indicator_mask, IND_REL,
+                   "REL");
+
+    if (pdata->seg7) {
+        draw_segments(pdata, r);
+    } else {
+        draw_number(pdata, r, all);
+    }
+    draw_derived(pdata, r);
+
+    pdata->reading = *r;
+    pdata->drawn = true;
+    pdata->readings++;
+    ESP_LOGD(TAG,
+             "reading %" PRIu32 ": %" PRIu32 " labels redrawn, %" PRIu32
+             " bytes not flushed",
+             r->seq, pdata->labels_set - set, pdata->bytes_saved - saved);
+}
 
-        pdata->digits[1] = get_nibble(new_call_s, 0);
-        draw_digit(pdata->figs[1], pdata->digits[1], pdata->decimal_mask & D1);
+#ifdef FLUKE8050_DRAW_BENCHMARK
+// Readings counting up by one, so the last digit changes every reading and
+// the others as often as they would with a drifting input.
+static void bench_reading(fluke8050_data_t *pdata, fluke8050_reading_t *r) {
+    uint32_t n = pdata->reading.seq + 1;
+    memset(r, 0, sizeof(*r));
+    r->seq = n;
+    r->time_us = esp_timer_get_time();
+    r->sign_mask = SIGN_BP | ((n / 10000) & 1 ? SIGN_MINUS : SIGN_PLUS);
+    if ((n / 20000) & 1) {
+        r->sign_mask |= SIGN_ONE;
+    }
+    r->decimal_mask = D1;
+    for (int i = 3; i >= 0; i--) {
+        r->digits[i] = n % 10;
+        n /= 10;
+    }
+}
 
-        pdata->digits[2] = get_nibble(new_call_s, 0);
-        draw_digit(pdata->figs[2], pdata->digits[2], pdata->decimal_mask & D2);
+static void log_bench(fluke8050_data_t *pdata) {
+    ESP_LOGI(TAG,
+             "%s: update %" PRIu64 "us refresh %" PRIu64 "us avg, %" PRIu32
+             "us max refresh per reading",
+             pdata->seg7 ? "seg7" : "labels",
+             pdata->update_us / pdata->readings,
+             pdata->refresh_us / pdata->readings, pdata->refresh_max_us);
+}
+#endif
 
-        pdata->digits[3] = get_nibble(new_call_s, 0);
-        draw_digit(pdata->figs[3], pdata->digits[3], pdata->decimal_mask & D3);
+static void log_counters(fluke8050_data_t *pdata) {
+    ESP_LOGI(TAG,
+             "%" PRIu32 " readings: %" PRIu32 " labels redrawn, %" PRIu32
+             " skipped, %" PRIu32 " bytes not flushed",
+             pdata->readings, pdata->labels_set, pdata->labels_skipped,
+             pdata->bytes_saved);
+    if (pdata->seg7) {
+        ESP_LOGI(TAG, "%" PRIu32 " segments invalidated",
+                 seg7_get_invalidations(pdata->seg7));
+    }
+    if (derived_count != 0) {
+        ESP_LOGI(TAG, "derived: %" PRIu32 " cycles per reading",
+                 derived_cycles / derived_count);
+    }
+#ifdef FLUKE8050_DRAW_BENCHMARK
+    log_bench(pdata);
+#endif
+}
 
+void fluke8050_screen_worker(lv_obj_t *screen, void *priv) {
+    fluke8050_data_t *pdata = priv;
+    int64_t new_call_ms = esp_timer_get_time() / 1000LL;
+    int64_t new_call_s = new_call_ms / 1000;
+    if (new_call_s != pdata->last_call_s) {
+        draw_fluke8050_title(pdata);
+        draw_stats(pdata);
         pdata->last_call_s = new_call_s;
+        if (pdata->readings) {
+            log_counters(pdata);
+        }
+    }
+
+    fluke8050_reading_t r;
+#ifdef FLUKE8050_DRAW_BENCHMARK
+    // Flush the title first so the refresh below only carries the reading.
+    lv_refr_now(NULL);
+    bench_reading(pdata, &r);
+    int64_t start = esp_timer_get_time();
+    draw_reading(pdata, &r);
+    int64_t drawn = esp_timer_get_time();
+    display_mark_update(r.time_us);
+    lv_refr_now(NULL);
+    uint32_t refresh = esp_timer_get_time() - drawn;
+    pdata->update_us += drawn - start;
+    pdata->refresh_us += refresh;
+    if (refresh > pdata->refresh_max_us) {
+        pdata->refresh_max_us = refresh;
+    }
+#else
+    if (fluke8050_bus_latest(pdata->meter, &r) &&
+        r.seq != pdata->reading.seq) {
+        draw_reading(pdata, &r);
+        display_mark_update(r.time_us);
     }
+#endif
 }
 
 #define CREATE_INIT(A, B, X, Y) \
@@ -219,27 +432,37 @@ void fluke8050_screen_worker(lv_obj_t *screen, void *priv) {
     lv_label_set_text(X, Y);    \
     lv_label_set_recolor(X, true);
 
-void *fluke8050_screen_init(lv_obj_t *screen) {
+// Title and indicators, shared by both views.
+static fluke8050_data_t *init_common(lv_obj_t *screen, uint8_t meter) {
     fluke8050_data_t *priv = calloc(1, sizeof(fluke8050_data_t));
     priv->window = screen;
+    priv->meter = meter;
 
     lv_coord_t swidth = lv_obj_get_width(priv->window);
     lv_coord_t w;
 
+    // Styles and the derived engines are shared by both views.
+    static bool shared_ready = false;
     static lv_style_t title_style;
-    lv_style_init(&title_style);
-    lv_style_set_text_font(&title_style, LV_STATE_DEFAULT,
-                           &lv_font_montserrat_12);
+    static lv_style_t ind_style;
+    if (!shared_ready) {
+        for (int i = 0; i < FLUKE8050_MAX_METERS; i++) {
+            derived_init(&derived[i]);
+            derived_gen[i] = 1;
+        }
+        lv_style_init(&title_style);
+        lv_style_set_text_font(&title_style, LV_STATE_DEFAULT,
+                               &lv_font_montserrat_12);
+        lv_style_init(&ind_style);
+        lv_style_set_text_font(&ind_style, LV_STATE_DEFAULT,
+                               &lv_font_montserrat_16);
+        shared_ready = true;
+    }
 
     CREATE_INIT(priv->window, NULL, priv->title, "Fluke 8050");
     lv_obj_add_style(priv->title, LV_LABEL_PART_MAIN, &title_style);
     draw_fluke8050_title(priv);
 
-    static lv_style_t ind_style;
-    lv_style_init(&ind_style);
-    lv_style_set_text_font(&ind_style, LV_STATE_DEFAULT,
-                           &lv_font_montserrat_16);
-
     CREATE_INIT(priv->window, NULL, priv->ind_db, "dB");
     lv_obj_add_style(priv->ind_db, LV_LABEL_PART_MAIN, &ind_style);
     lv_obj_set_size(priv->ind_db, 12, 18);
@@ -262,10 +485,27 @@ void *fluke8050_screen_init(lv_obj_t *screen) {
     lv_obj_add_style(priv->ind_bat, LV_LABEL_PART_MAIN, &ind_style);
     lv_obj_set_pos(priv->ind_bat, 0, 0);
 
+    CREATE_INIT(priv->window, NULL, priv->stats, "no readings");
+    lv_obj_add_style(priv->stats, LV_LABEL_PART_MAIN, &title_style);
+    lv_obj_set_pos(priv->stats, 0, lv_obj_get_height(priv->window) - 32);
+
+    CREATE_INIT(priv->window, NULL, priv->derived, "");
+    lv_obj_add_style(priv->derived, LV_LABEL_PART_MAIN, &ind_style);
+    lv_obj_set_pos(priv->derived, 0, lv_obj_get_height(priv->window) - 52);
+    return priv;
+}
+
+void *fluke8050_screen_init(lv_obj_t *screen, uint8_t meter) {
+    fluke8050_data_t *priv = init_common(screen, meter);
+
+    static bool num_style_ready = false;
     static lv_style_t num_style;
-    lv_style_init(&num_style);
-    lv_style_set_text_font(&num_style, LV_STATE_DEFAULT,
-                           &lv_font_montserrat_40);
+    if (!num_style_ready) {
+        lv_style_init(&num_style);
+        lv_style_set_text_font(&num_style, LV_STATE_DEFAULT,
+                               &lv_font_montserrat_40);
+        num_style_ready = true;
+    }
     uint8_t top = 18;
 
     CREATE_INIT(priv->window, NULL, priv->sign, "+");
@@ -281,14 +521,21 @@ void *fluke8050_screen_init(lv_obj_t *screen) {
         lv_obj_add_style(priv->figs[i], LV_LABEL_PART_MAIN, &num_style);
         lv_obj_set_pos(priv->figs[i], 48 + i * 37, top);
     }
+    return priv;
+}
+
+void *fluke8050_seg7_screen_init(lv_obj_t *screen, uint8_t meter) {
+    fluke8050_data_t *priv = init_common(screen, meter);
 
-#define GPIO1 (1 << 25)
-#define GPIO2 (1 << 26)
-    uint32_t w1ts[] = {GPIO1, GPIO2, 0};
-    uint32_t w1tc[] = {0, GPIO1, GPIO2};
-    init_gpios(2, 3);
-    write_set_bank(0, 0, 3, w1ts);
-    write_clear_bank(0, 0, 3, w1tc);
-    set_active_bank(0);
+    // Six cells 37 pixels apart, as wide as the labels they stand in for.
+    const seg7_geometry_t geo = {
+        .width = 24, .height = 60, .thickness = 5, .gap = 4};
+    priv->seg7 = seg7_create(priv->window, &geo, 6);
+    seg7_set_colors(priv->seg7, LV_COLOR_GREEN,
+                    LV_COLOR_MAKE(0x00, 0x10, 0x00));
+    lv_obj_set_pos(priv->seg7, 0, 22);
     return priv;
 }
+
+// Both views; the objects go with the screen.
+void fluke8050_screen_free(lv_obj_t *screen, void *priv) { free(priv); }
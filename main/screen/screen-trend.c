@@ -0,0 +1,285 @@
+#include "screen-trend.h"
+
+#include "display-port.h"
+#include "fluke8050-bus.h"
+#include "fluke8050-decoder.h"
+#include "inttypes.h"
+#include "screen-core.h"
+
+// Reading history as a line chart, one column per pixel. Each column holds
+// the min and max of its share of the history, drawn as two series, so a
+// one sample spike still shows however many samples a column covers.
+// Columns split the held samples evenly, not time. Shows one meter.
+//
+// A redraw walks the whole history, which the bus keeps to
+// FLUKE8050_HISTORY_SAMPLES, so its cost is bounded by that.
+#define TREND_BATCH 32
+#define TREND_Y_MAX 1000
+
+typedef size_t (*trend_copy_t)(uint8_t meter, uint32_t from,
+                               history_sample_t *out, size_t max,
+                               uint32_t *next);
+
+typedef struct trend_data {
+    uint8_t meter;
+    uint32_t drawn_total;  // History total the chart shows
+    bool dirty;
+    int64_t last_draw_us;
+    int64_t last_call_s;
+
+    // Redraw cost: decimating the history, then rendering and flushing.
+    uint32_t redraws;
+    uint32_t samples;  // In the last redraw
+    uint32_t decimate_us;
+    uint32_t refresh_us;
+    uint32_t decimate_max_us;
+
+    uint16_t columns;
+    int32_t *col_min;
+    int32_t *col_max;
+
+    lv_obj_t *window;
+    lv_obj_t *title;
+    lv_obj_t *chart;
+    lv_chart_series_t *max_series;
+    lv_chart_series_t *min_series;
+} trend_data_t;
+
+static const char *TAG = "trend";
+
+// Folds samples [first, total) into columns. Returns how many columns got
+// samples, fewer than columns when there are fewer samples than that.
+static uint16_t decimate(trend_copy_t copy, uint8_t meter, uint32_t first,
+                         uint32_t total, int32_t *mins, int32_t *maxs,
+                         uint16_t columns) {
+    uint32_t n = total - first;
+    if (n == 0) {
+        return 0;
+    }
+    uint16_t used = n < columns ? n : columns;
+    for (int i = 0; i < used; i++) {
+        mins[i] = INT32_MAX;
+        maxs[i] = INT32_MIN;
+    }
+
+    history_sample_t batch[TREND_BATCH];
+    uint32_t from = first;
+    while (from < total) {
+        uint32_t next;
+        size_t got = copy(meter, from, batch, TREND_BATCH, &next);
+        if (got == 0) {
+            break;
+        }
+        // Samples overwritten since first are skipped, not renumbered.
+        uint32_t k = next - got;
+        for (size_t i = 0; i < got && k < total; i++, k++) {
+            uint16_t c = (uint64_t)(k - first) * used / n;
+            if (batch[i].value < mins[c]) {
+                mins[c] = batch[i].value;
+            }
+            if (batch[i].value > maxs[c]) {
+                maxs[c] = batch[i].value;
+            }
+        }
+        from = next;
+    }
+    return used;
+}
+
+static lv_coord_t scale(int32_t v, int32_t lo, int32_t hi) {
+    if (hi == lo) {
+        return TREND_Y_MAX / 2;
+    }
+    return (int64_t)(v - lo) * TREND_Y_MAX / ((int64_t)hi - lo);
+}
+
+static void draw_trend(trend_data_t *pdata, uint32_t first, uint32_t total) {
+    int64_t start = esp_timer_get_time();
+    uint16_t used =
+        decimate(fluke8050_bus_history_copy, pdata->meter, first, total,
+                 pdata->col_min, pdata->col_max, pdata->columns);
+    int64_t decimated = esp_timer_get_time();
+
+    int32_t lo = INT32_MAX;
+    int32_t hi = INT32_MIN;
+    for (int i = 0; i < used; i++) {
+        if (pdata->col_min[i] < lo && pdata->col_min[i] != INT32_MAX) {
+            lo = pdata->col_min[i];
+        }
+        if (pdata->col_max[i] > hi && pdata->col_max[i] != INT32_MIN) {
+            hi = pdata->col_max[i];
+        }
+    }
+
+    // Columns a skipped stretch left empty are drawn as gaps.
+    for (int i = 0; i < pdata->columns; i++) {
+        bool empty = i >= used || pdata->col_min[i] == INT32_MAX;
+        pdata->min_series->points[i] =
+            empty ? LV_CHART_POINT_DEF : scale(pdata->col_min[i], lo, hi);
+        pdata->max_series->points[i] =
+            empty ? LV_CHART_POINT_DEF : scale(pdata->col_max[i], lo, hi);
+    }
+    lv_chart_refresh(pdata->chart);
+
+    char buff[64];
+    if (used == 0) {
+        snprintf(buff, sizeof(buff), "Trend: no readings");
+    } else {
+        char min[16], max[16];
+        fluke8050_format_value(lo, min, sizeof(min));
+        fluke8050_format_value(hi, max, sizeof(max));
+        snprintf(buff, sizeof(buff), "%" PRIu32 "  %s .. %s", total - first,
+                 min, max);
+    }
+    lv_label_set_text(pdata->title, buff);
+
+    lv_refr_now(NULL);
+    int64_t end = esp_timer_get_time();
+
+    pdata->redraws++;
+    pdata->samples = total - first;
+    pdata->decimate_us = decimated - start;
+    pdata->refresh_us = end - decimated;
+    if (pdata->decimate_us > pdata->decimate_max_us) {
+        pdata->decimate_max_us = pdata->decimate_us;
+    }
+    ESP_LOGD(TAG,
+             "%" PRIu32 " samples: decimate %" PRIu32 "us refresh %" PRIu32
+             "us",
+             pdata->samples, pdata->decimate_us, pdata->refresh_us);
+}
+
+#ifdef TREND_BENCHMARK
+static history_sample_t bench_samples[FLUKE8050_HISTORY_SAMPLES];
+static reading_history_t bench_history;
+
+static size_t bench_copy(uint8_t meter, uint32_t from, history_sample_t *out,
+                         size_t max, uint32_t *next) {
+    return history_copy(&bench_history, from, out, max, next);
+}
+
+// Decimation time against history length, doubling up to twice what the
+// ring holds. Rendering always has one point per column so it doesn't
+// depend on the length; the live log covers it.
+static void trend_benchmark(trend_data_t *pdata) {
+    history_init(&bench_history, bench_samples, FLUKE8050_HISTORY_SAMPLES);
+    uint32_t pushed = 0;
+    for (uint32_t len = pdata->columns; len <= 2 * FLUKE8050_HISTORY_SAMPLES;
+         len *= 2) {
+        for (; pushed < len; pushed++) {
+            int32_t v = pushed * 3 + (pushed * 2654435761u >> 28);
+            if (pushed % 997 == 0) {
+                v += 50000;
+            }
+            history_push(&bench_history, pushed * 400, v);
+        }
+        uint32_t first = history_first(&bench_history);
+        int64_t start = esp_timer_get_time();
+        decimate(bench_copy, 0, first, bench_history.total, pdata->col_min,
+                 pdata->col_max, pdata->columns);
+        ESP_LOGI(TAG, "bench: %" PRIu32 " samples decimated in %" PRId64 "us",
+                 bench_history.total - first, esp_timer_get_time() - start);
+    }
+}
+#endif
+
+void trend_screen_worker(lv_obj_t *screen, void *priv) {
+    trend_data_t *pdata = priv;
+    int64_t now = esp_timer_get_time();
+
+    int64_t new_call_s = now / 1000000LL;
+    if (new_call_s != pdata->last_call_s && pdata->redraws != 0) {
+        pdata->last_call_s = new_call_s;
+        ESP_LOGI(TAG,
+                 "%" PRIu32 " samples: decimate %" PRIu32 "us (max %" PRIu32
+                 "us) refresh %" PRIu32 "us",
+                 pdata->samples, pdata->decimate_us, pdata->decimate_max_us,
+                 pdata->refresh_us);
+    }
+
+    uint32_t first, total;
+    fluke8050_bus_history_span(pdata->meter, &first, &total);
+    if (!pdata->dirty && total == pdata->drawn_total) {
+        return;
+    }
+    // New readings come a few times a second; the chart doesn't need them
+    // all.
+    if (!pdata->dirty && now - pdata->last_draw_us < 500000) {
+        return;
+    }
+    draw_trend(pdata, first, total);
+    pdata->drawn_total = total;
+    pdata->dirty = false;
+    pdata->last_draw_us = now;
+}
+
+void trend_screen_load(lv_obj_t *screen, void *priv) {
+    trend_data_t *pdata = priv;
+    pdata->dirty = true;
+}
+
+void trend_screen_unload(lv_obj_t *screen, void *priv) {
+    trend_data_t *pdata = priv;
+    if (pdata->redraws != 0) {
+        ESP_LOGI(TAG, "%" PRIu32 " redraws, worst decimate %" PRIu32 "us",
+                 pdata->redraws, pdata->decimate_max_us);
+    }
+}
+
+#define CREATE_INIT(A, B, X, Y) \
+    X = lv_label_create(A, B);  \
+    lv_label_set_text(X, Y);    \
+    lv_label_set_recolor(X, true);
+
+void *trend_screen_init(lv_obj_t *screen, uint8_t meter) {
+    trend_data_t *priv = calloc(1, sizeof(trend_data_t));
+    priv->window = screen;
+    priv->meter = meter;
+    priv->dirty = true;
+
+    lv_coord_t swidth = lv_obj_get_width(priv->window);
+    lv_coord_t sheight = lv_obj_get_height(priv->window);
+
+    priv->columns = swidth;
+    priv->col_min = calloc(priv->columns, sizeof(int32_t));
+    priv->col_max = calloc(priv->columns, sizeof(int32_t));
+
+    // Kept for the next build of the screen.
+    static bool text_style_ready = false;
+    static lv_style_t text_style;
+    if (!text_style_ready) {
+        lv_style_init(&text_style);
+        lv_style_set_text_font(&text_style, LV_STATE_DEFAULT,
+                               &lv_font_montserrat_12);
+        text_style_ready = true;
+    }
+
+    CREATE_INIT(priv->window, NULL, priv->title, "Trend");
+    lv_obj_add_style(priv->title, LV_LABEL_PART_MAIN, &text_style);
+    lv_obj_set_pos(priv->title, 0, 0);
+
+    priv->chart = lv_chart_create(priv->window, NULL);
+    lv_obj_set_pos(priv->chart, 0, 16);
+    lv_obj_set_size(priv->chart, swidth, sheight - 16);
+    lv_chart_set_type(priv->chart, LV_CHART_TYPE_LINE);
+    lv_chart_set_point_count(priv->chart, priv->columns);
+    lv_chart_set_y_range(priv->chart, LV_CHART_AXIS_PRIMARY_Y, 0, TREND_Y_MAX);
+    lv_chart_set_div_line_count(priv->chart, 3, 0);
+    priv->max_series = lv_chart_add_series(priv->chart, LV_COLOR_GREEN);
+    priv->min_series =
+        lv_chart_add_series(priv->chart, LV_COLOR_MAKE(0x00, 0x80, 0x00));
+    lv_chart_init_points(priv->chart, priv->max_series, LV_CHART_POINT_DEF);
+    lv_chart_init_points(priv->chart, priv->min_series, LV_CHART_POINT_DEF);
+
+#ifdef TREND_BENCHMARK
+    trend_benchmark(priv);
+#endif
+    return priv;
+}
+
+void trend_screen_free(lv_obj_t *screen, void *priv) {
+    trend_data_t *pdata = priv;
+    free(pdata->col_min);
+    free(pdata->col_max);
+    free(pdata);
+}
@@ -0,0 +1,154 @@
+#include "widget-seg7.h"
+
+typedef struct seg7_cell {
+    uint16_t segs;
+    lv_area_t area[SEG7_SEGMENTS];  // Relative to the object
+} seg7_cell_t;
+
+typedef struct seg7_ext {
+    lv_color_t on;
+    lv_color_t off;
+    uint32_t invalidations;
+    uint8_t cells;
+    seg7_cell_t cell[];
+} seg7_ext_t;
+
+static void set_area(lv_area_t *a, lv_coord_t x1, lv_coord_t y1, lv_coord_t x2,
+                     lv_coord_t y2) {
+    a->x1 = x1;
+    a->y1 = y1;
+    a->x2 = x2;
+    a->y2 = y2;
+}
+
+// Lays out one cell whose decimal point starts at x.
+static void layout_cell(seg7_cell_t *c, const seg7_geometry_t *g,
+                        lv_coord_t x) {
+    lv_coord_t t = g->thickness;
+    lv_coord_t w = g->width;
+    lv_coord_t h = g->height;
+    lv_coord_t m = h / 2;
+    lv_coord_t dx = x + t + g->gap;
+    lv_coord_t bar = w / 2 - t;
+
+    set_area(&c->area[0], dx + t, 0, dx + w - t - 1, t - 1);
+    set_area(&c->area[1], dx + w - t, t, dx + w - 1, m - 1);
+    set_area(&c->area[2], dx + w - t, m, dx + w - 1, h - t - 1);
+    set_area(&c->area[3], dx + t, h - t, dx + w - t - 1, h - 1);
+    set_area(&c->area[4], dx, m, dx + t - 1, h - t - 1);
+    set_area(&c->area[5], dx, t, dx + t - 1, m - 1);
+    set_area(&c->area[6], dx + t, m - t / 2, dx + w - t - 1, m - t / 2 + t - 1);
+    set_area(&c->area[7], x, h - t, x + t - 1, h - 1);
+    lv_coord_t bx = dx + w / 2 - t / 2;
+    set_area(&c->area[8], bx, m - bar, bx + t - 1, m + bar - 1);
+}
+
+static void draw_segments(const seg7_ext_t *ext, const lv_area_t *coords,
+                          const lv_area_t *clip_area, bool on) {
+    lv_draw_rect_dsc_t dsc;
+    lv_draw_rect_dsc_init(&dsc);
+    dsc.bg_color = on ? ext->on : ext->off;
+    dsc.bg_opa = LV_OPA_COVER;
+
+    for (int i = 0; i < ext->cells; i++) {
+        const seg7_cell_t *c = &ext->cell[i];
+        for (int s = 0; s < SEG7_SEGMENTS; s++) {
+            if (((c->segs & BIT(s)) != 0) != on) {
+                continue;
+            }
+            lv_area_t a, tmp;
+            set_area(&a, coords->x1 + c->area[s].x1, coords->y1 + c->area[s].y1,
+                     coords->x1 + c->area[s].x2, coords->y1 + c->area[s].y2);
+            if (_lv_area_intersect(&tmp, &a, clip_area)) {
+                lv_draw_rect(&a, clip_area, &dsc);
+            }
+        }
+    }
+}
+
+// Unlit segments first so where the bar crosses G the lit one wins. The
+// parent draws the background.
+static lv_design_res_t seg7_design(lv_obj_t *obj, const lv_area_t *clip_area,
+                                   lv_design_mode_t mode) {
+    if (mode == LV_DESIGN_COVER_CHK) {
+        return LV_DESIGN_RES_NOT_COVER;
+    }
+    if (mode == LV_DESIGN_DRAW_MAIN) {
+        const seg7_ext_t *ext = lv_obj_get_ext_attr(obj);
+        lv_area_t coords;
+        lv_obj_get_coords(obj, &coords);
+        draw_segments(ext, &coords, clip_area, false);
+        draw_segments(ext, &coords, clip_area, true);
+    }
+    return LV_DESIGN_RES_OK;
+}
+
+lv_obj_t *seg7_create(lv_obj_t *parent, const seg7_geometry_t *geo,
+                      uint8_t cells) {
+    lv_obj_t *obj = lv_obj_create(parent, NULL);
+    if (obj == NULL) {
+        return NULL;
+    }
+    seg7_ext_t *ext = lv_obj_allocate_ext_attr(
+        obj, sizeof(seg7_ext_t) + cells * sizeof(seg7_cell_t));
+    if (ext == NULL) {
+        lv_obj_del(obj);
+        return NULL;
+    }
+    ext->on = LV_COLOR_GREEN;
+    ext->off = LV_COLOR_BLACK;
+    ext->invalidations = 0;
+    ext->cells = cells;
+
+    lv_coord_t pitch = geo->thickness + geo->gap + geo->width + geo->gap;
+    for (int i = 0; i < cells; i++) {
+        ext->cell[i].segs = 0;
+        layout_cell(&ext->cell[i], geo, i * pitch);
+    }
+
+    lv_obj_set_design_cb(obj, seg7_design);
+    lv_obj_set_size(obj, cells * pitch, geo->height);
+    return obj;
+}
+
+void seg7_set_colors(lv_obj_t *seg7, lv_color_t on, lv_color_t off) {
+    seg7_ext_t *ext = lv_obj_get_ext_attr(seg7);
+    ext->on = on;
+    ext->off = off;
+    lv_obj_invalidate(seg7);
+}
+
+void seg7_set_cell(lv_obj_t *seg7, uint8_t cell, uint16_t segs) {
+    seg7_ext_t *ext = lv_obj_get_ext_attr(seg7);
+    if (cell >= ext->cells) {
+        return;
+    }
+    seg7_cell_t *c = &ext->cell[cell];
+    uint16_t changed = c->segs ^ segs;
+    c->segs = segs;
+    if (changed == 0) {
+        return;
+    }
+
+    lv_area_t coords;
+    lv_obj_get_coords(seg7, &coords);
+    for (int s = 0; s < SEG7_SEGMENTS; s++) {
+        if (changed & BIT(s)) {
+            lv_area_t a;
+            set_area(&a, coords.x1 + c->area[s].x1, coords.y1 + c->area[s].y1,
+                     coords.x1 + c->area[s].x2, coords.y1 + c->area[s].y2);
+            lv_obj_invalidate_area(seg7, &a);
+            ext->invalidations++;
+        }
+    }
+}
+
+uint16_t seg7_get_cell(const lv_obj_t *seg7, uint8_t cell) {
+    const seg7_ext_t *ext = lv_obj_get_ext_attr(seg7);
+    return cell < ext->cells ? ext->cell[cell].segs : 0;
+}
+
+uint32_t seg7_get_invalidations(const lv_obj_t *seg7) {
+    const seg7_ext_t *ext = lv_obj_get_ext_attr(seg7);
+    return ext->invalidations;
+}
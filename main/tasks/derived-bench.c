@@ -0,0 +1,80 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "derived-bench.h"
+
+#include "esp_log.h"
+#include "fluke8050-decoder.h"
+#include "fluke8050-derived.h"
+#include "inttypes.h"
+#include "math.h"
+#include "xtensa/core-macros.h"
+
+#define BENCH_READINGS 1000
+
+static const char *TAG = "derived-bench";
+
+static const char *mode_names[DERIVED_MODES] = {"off", "rel", "dBV", "dBm",
+                                                "scale"};
+
+// Spread over every range: 1 count up to 19999 with the point anywhere.
+static int32_t bench_value(int i) {
+    int32_t v = 1 + (int32_t)((uint32_t)i * 2654435761u % 19999);
+    for (int s = i % 5; s > 0; s--) {
+        v *= 10;
+    }
+    return i & 1 ? -v : v;
+}
+
+void derived_benchmark() {
+    derived_t d;
+    derived_init(&d);
+    d.unit = DERIVED_UNIT_V;  // Or the dB modes have no result
+    volatile int32_t sink = 0;
+
+    for (int mode = DERIVED_REL; mode < DERIVED_MODES; mode++) {
+        derived_set_mode(&d, mode, bench_value(0));
+        uint32_t start = XTHAL_GET_CCOUNT();
+        for (int i = 0; i < BENCH_READINGS; i++) {
+            int32_t out;
+            if (derived_apply(&d, bench_value(i), &out)) {
+                sink += out;
+            }
+        }
+        uint32_t cycles = XTHAL_GET_CCOUNT() - start;
+        ESP_LOGI(TAG, "%s: %" PRIu32 " cycles per reading", mode_names[mode],
+                 cycles / BENCH_READINGS);
+    }
+
+    // The same dBm with soft float double, for comparison.
+    uint32_t start = XTHAL_GET_CCOUNT();
+    for (int i = 0; i < BENCH_READINGS; i++) {
+        double v = fabs((double)bench_value(i) / FLUKE8050_VALUE_SCALE);
+        sink += (int32_t)((20.0 * log10(v) + 30.0 - 10.0 * log10(600.0)) *
+                          FLUKE8050_VALUE_SCALE);
+    }
+    uint32_t cycles = XTHAL_GET_CCOUNT() - start;
+    ESP_LOGI(TAG, "libm dBm: %" PRIu32 " cycles per reading",
+             cycles / BENCH_READINGS);
+
+    // bench_value() itself, to take off the figures above.
+    start = XTHAL_GET_CCOUNT();
+    for (int i = 0; i < BENCH_READINGS; i++) {
+        sink += bench_value(i);
+    }
+    cycles = XTHAL_GET_CCOUNT() - start;
+    ESP_LOGI(TAG, "overhead: %" PRIu32 " cycles per reading",
+             cycles / BENCH_READINGS);
+}
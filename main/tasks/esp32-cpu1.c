@@ -17,137 +17,638 @@
 
 #include <stdio.h>
 
+#include "sequencer-core.h"
+
+// Hardware access goes through sequencer-port.h; only starting the APP cpu
+// is target specific, see start_app_cpu().
+#ifndef SEQUENCER_HOST
 #include "esp32/rom/ets_sys.h"
-#include "esp_heap_caps.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "hal/gpio_ll.h"
-#include "soc/gpio_periph.h"
-#include "soc/gpio_struct.h"
+#include "esp_intr_alloc.h"
+
+#define APP_CPU_STACK_SIZE 1024
 
 void launch_cpu1();
-volatile DRAM_ATTR uint32_t cpu1_counter = 0;
 void DRAM_ATTR *app_cpu_stack_ptr = NULL;
+static intr_handle_t app_cpu_intr = NULL;
+#endif
+
+// The allocation behind arena, see sequencer-core.h.
+static void *arena_raw = NULL;
+static size_t arena_capacity = 0;  // in bytes
+static pattern_mem_t arena_mem = PATTERN_MEM_DRAM;
+
+// The last bank the PRO cpu asked for, 0xFF for none.
+static uint8_t set_bank = 0xFF;
+// The last two pacings asked for. The APP cpu may still be finishing a
+// cycle at the older one.
+static uint32_t pace_set = 0;
+static uint32_t pace_prev = 0;
+
+// Shadow pool for patches staged against live banks. The PRO cpu allocates
+// from shadow_head and the FROM_CPU_INTR2 handler frees up to the end of each
+// completed patch, in mailbox order.
+#define SHADOW_POOL_WORDS 512
+static DRAM_ATTR uint32_t shadow_pool[SHADOW_POOL_WORDS];
+static uint32_t shadow_head = 0;
+static uint32_t shadow_tail = 0;
+
+// PRO cpu side bookkeeping for each mailbox slot.
+typedef struct cmd_meta {
+    cpu1_done_cb_t cb;
+    void *arg;
+    bool last;
+    bool swap;
+    bool shadow;
+    uint32_t gpios;
+    uint32_t submit_ccount;
+    uint32_t shadow_end;
+} cmd_meta_t;
 
-// While modified from the PRO cpu, these do not need to be volatile
-// as we gate modifying them across the switch callback.
-volatile DRAM_ATTR uint32_t *volatile *volatile w1ts = NULL;
-volatile DRAM_ATTR uint32_t *volatile *volatile w1tc = NULL;
-volatile DRAM_ATTR uint8_t banks = 0;
-volatile DRAM_ATTR uint8_t pages = 0;
+static seq_lock_t mailbox_mux = SEQ_LOCK_INIT;
+static cmd_meta_t cmd_meta[CPU1_MAILBOX_SIZE] = {0};
+static cpu1_status_t batch_status = CPU1_OK;
+static uint32_t last_swap_seq = 0;
+static uint32_t last_switch_cycles = 0;
+static uint32_t max_switch_cycles = 0;
+// Outputs enabled for the APP cpu, released when no bank drives them.
+static uint32_t output_gpios = 0;
 
-// 0xFF means inactive
-volatile DRAM_ATTR uint8_t active_bank = 0xFF;
-volatile DRAM_ATTR uint8_t set_bank = 0xFF;
+typedef struct app_cpu_wake {
+    bool pending;
+    uint32_t wakeups;
+    uint32_t req_ccount;
+    uint32_t last_cycles;
+    uint32_t max_cycles;
+} app_cpu_wake_t;
+static app_cpu_wake_t wake = {0};
 
-#define STRX(a) #a
-#define STR(a) STRX(a)
+// CPU1_READ_STATS from cpu1_request_stats() lands here rather than in the
+// caller's buffer, so a read that outlives its caller has nowhere stale to
+// write. stats_seq is the read in flight, 0 before the first.
+static DRAM_ATTR cpu1_stats_t stats_snapshot;
+static uint32_t stats_seq = 0;
 
-#define ERR_ON(X, Y)                              \
-    if (X) {                                      \
-        printf("%s: %s\n", __FUNCTION__, STR(X)); \
-        Y;                                        \
+static void IRAM_ATTR app_cpu_isr(void *arg) {
+    seq_ack();
+
+    seq_lock(&mailbox_mux);
+    if (wake.pending && app_cpu_wakeups != wake.wakeups) {
+        wake.last_cycles = seq_ccount() - wake.req_ccount;
+        if (wake.last_cycles > wake.max_cycles) {
+            wake.max_cycles = wake.last_cycles;
+        }
+        wake.pending = false;
     }
+    seq_unlock(&mailbox_mux);
+
+    while (true) {
+        seq_lock(&mailbox_mux);
+        uint32_t pos = mailbox.resp_tail;
+        if (pos == mailbox.cmd_tail) {
+            seq_unlock(&mailbox_mux);
+            break;
+        }
+        seq_memw();
+        cmd_meta_t meta = cmd_meta[SLOT(pos)];
+        cpu1_status_t status = mailbox.status[SLOT(pos)];
+        uint32_t seq = pos + 1;
+
+        if (status != CPU1_OK && batch_status == CPU1_OK) {
+            batch_status = status;
+        }
+        if (meta.shadow) {
+            shadow_tail = meta.shadow_end;
+        }
+        if (meta.swap && seq == last_swap_seq) {
+            last_switch_cycles = seq_ccount() - meta.submit_ccount;
+            if (last_switch_cycles > max_switch_cycles) {
+                max_switch_cycles = last_switch_cycles;
+            }
+            // Pins only the old banks drove can go back to inputs now that
+            // the APP cpu has stopped writing them.
+            uint32_t stale = output_gpios & ~meta.gpios;
+            seq_enable(0, stale);
+            output_gpios &= ~stale;
+        }
+        if (meta.last) {
+            status = batch_status;
+            batch_status = CPU1_OK;
+        }
+        mailbox.resp_tail = seq;
+        seq_unlock(&mailbox_mux);
 
-uint32_t output_gpios = 0;
-void update_gpio_directions(uint8_t bank) {
-    GPIO.enable_w1tc = output_gpios;
-    output_gpios = 0;
-    for (int i = 0; i < pages; i++) {
-        output_gpios |= w1ts[bank][i];
-        output_gpios |= w1tc[bank][i];
+        if (meta.last && meta.cb != NULL) {
+            meta.cb(seq, status, meta.arg);
+        }
     }
-    GPIO.enable_w1ts = output_gpios;
 }
 
-bool set_active_bank(uint8_t bank) {
-    ERR_ON(bank >= banks && bank != 0xFF, return false);
-    set_bank = 0xFF;
-    while (active_bank != 0xFF) {
-        printf("Waiting for Task to stop\n");
-        vTaskDelay(100);
+#ifdef SEQUENCER_HOST
+static bool app_cpu_started = false;
+
+static void start_app_cpu() {
+    if (!app_cpu_started) {
+        ERR_ON(!sim_start(app_cpu_isr), return);
+        app_cpu_started = true;
+    }
+}
+#else
+static void start_app_cpu() {
+    if (app_cpu_intr == NULL) {
+        ERR_ON(esp_intr_alloc(ETS_FROM_CPU_INTR2_SOURCE, ESP_INTR_FLAG_IRAM,
+                              app_cpu_isr, NULL, &app_cpu_intr) != ESP_OK,
+               return);
+        launch_cpu1();
     }
-    update_gpio_directions(bank);
-    set_bank = bank;
-    while (active_bank != bank) {
-        printf("Waiting for Task to start\n");
-        vTaskDelay(100);
+}
+#endif
+
+static bool prepare_cmds(const cpu1_cmd_t *cmds, size_t count,
+                         uint32_t *gpios) {
+    ERR_ON(cmds == NULL, return false);
+    ERR_ON(count == 0 || count > CPU1_MAILBOX_SIZE, return false);
+
+    for (size_t i = 0; i < count; i++) {
+        ERR_ON(!check_cmd(&cmds[i]), return false);
+        gpios[i] = 0;
+        if (cmds[i].op == CPU1_SWAP_BANK) {
+            gpios[i] = bank_gpios(cmds[i].bank);
+        } else if (cmds[i].op == CPU1_PATCH_PAGES) {
+            gpios[i] = patch_gpios(cmds[i].len, cmds[i].fields, cmds[i].src,
+                                   field_count(cmds[i].fields));
+        }
     }
+
+    start_app_cpu();
     return true;
 }
 
-bool write_bank(volatile uint32_t *volatile *volatile bankset, uint8_t bank,
-                uint8_t offset, uint8_t len, uint32_t *values) {
-    ERR_ON(bank == active_bank, return false);
+// Called with mailbox_mux held. shadow is true when the batch holds shadow
+// pool memory up to shadow_head, to be released when it completes.
+static uint32_t enqueue_cmds(const cpu1_cmd_t *cmds, const uint32_t *gpios,
+                             size_t count, cpu1_done_cb_t cb, void *arg,
+                             bool shadow) {
+    uint32_t head = mailbox.cmd_head;
+    if (head + count - mailbox.resp_tail > CPU1_MAILBOX_SIZE) {
+        return 0;
+    }
+
+    uint32_t now = seq_ccount();
+    for (size_t i = 0; i < count; i++) {
+        uint32_t slot = SLOT(head + i);
+        mailbox.cmd[slot] = cmds[i];
+
+        cmd_meta_t *meta = &cmd_meta[slot];
+        meta->cb = cb;
+        meta->arg = arg;
+        meta->last = (i == count - 1);
+        meta->swap = (cmds[i].op == CPU1_SWAP_BANK);
+        meta->shadow = shadow && meta->last;
+        meta->shadow_end = shadow_head;
+        meta->gpios = gpios[i];
+        meta->submit_ccount = now;
+
+        // Outputs are enabled before the APP cpu can drive them, and only
+        // released once a swap has been acked.
+        seq_enable(gpios[i], 0);
+        output_gpios |= gpios[i];
+        if (meta->swap) {
+            set_bank = cmds[i].bank;
+            last_swap_seq = head + i + 1;
+        } else if (cmds[i].op == CPU1_SET_PACING) {
+            pace_prev = pace_set;
+            pace_set = cmds[i].pace_cycles;
+        }
+    }
+    seq_memw();
+    mailbox.cmd_head = head + count;
+    return head + count;
+}
+
+uint32_t cpu1_submit(const cpu1_cmd_t *cmds, size_t count, cpu1_done_cb_t cb,
+                     void *arg) {
+    uint32_t gpios[CPU1_MAILBOX_SIZE];
+    ERR_ON(!prepare_cmds(cmds, count, gpios), return 0);
+
+    seq_lock(&mailbox_mux);
+    uint32_t seq = enqueue_cmds(cmds, gpios, count, cb, arg, false);
+    seq_unlock(&mailbox_mux);
+
+    wake_app_cpu();
+    return seq;
+}
+
+// Called with mailbox_mux held. Allocations are contiguous; if one would
+// wrap, the tail end of the pool is skipped.
+static uint32_t *shadow_alloc(uint32_t words) {
+    uint32_t pos = shadow_head % SHADOW_POOL_WORDS;
+    uint32_t skip = 0;
+    if (pos + words > SHADOW_POOL_WORDS) {
+        skip = SHADOW_POOL_WORDS - pos;
+        pos = 0;
+    }
+    if (shadow_head + skip + words - shadow_tail > SHADOW_POOL_WORDS) {
+        return NULL;
+    }
+    shadow_head += skip + words;
+    return &shadow_pool[pos];
+}
+
+uint32_t patch_pages(uint8_t bank, uint8_t offset, uint8_t len,
+                     patch_fields_t fields, const uint32_t *src,
+                     uint8_t stride, cpu1_done_cb_t cb, void *arg) {
+    uint8_t words = field_count(fields);
+    ERR_ON(src == NULL, return 0);
+    ERR_ON(stride < words, return 0);
+    ERR_ON(len * words > SHADOW_POOL_WORDS, return 0);
+
+    // Validate against the caller's buffer, then point at the shadow copy.
+    cpu1_cmd_t cmd = {.op = CPU1_PATCH_PAGES,
+                      .bank = bank,
+                      .offset = offset,
+                      .len = len,
+                      .fields = fields};
+    uint32_t gpios = 0;
+    if (stride == words) {
+        cmd.src = src;
+        ERR_ON(!prepare_cmds(&cmd, 1, &gpios), return 0);
+    } else {
+        // check_cmd() wants packed words; check what it would, here.
+        ERR_ON(fields == 0 || fields & ~PATCH_TIMED_PAGE, return 0);
+        ERR_ON(pattern_format == PATTERN_RLE, return 0);
+        ERR_ON(pattern_format != PATTERN_TIMED && (fields & PATCH_CYCLES),
+               return 0);
+        ERR_ON(bank >= banks || len == 0 || offset + len > pages, return 0);
+        for (uint8_t i = 0; (fields & PATCH_CYCLES) && i < len; i++) {
+            ERR_ON(src[i * stride + words - 1] < TIMED_PAGE_MIN_CYCLES,
+                   return 0);
+        }
+        gpios = patch_gpios(len, fields, src, stride);
+        start_app_cpu();
+    }
+
+    seq_lock(&mailbox_mux);
+    uint32_t old_head = shadow_head;
+    uint32_t *shadow = shadow_alloc(len * words);
+    uint32_t seq = 0;
+    if (shadow != NULL) {
+        for (uint8_t i = 0; i < len; i++) {
+            for (uint8_t w = 0; w < words; w++) {
+                shadow[i * words + w] = src[i * stride + w];
+            }
+        }
+        cmd.src = shadow;
+        seq = enqueue_cmds(&cmd, &gpios, 1, cb, arg, true);
+        if (seq == 0) {
+            shadow_head = old_head;
+        }
+    }
+    seq_unlock(&mailbox_mux);
+
+    wake_app_cpu();
+    return seq;
+}
+
+bool cpu1_done(uint32_t seq) {
+    return (int32_t)(mailbox.cmd_tail - seq) >= 0;
+}
+
+bool cpu1_wait(uint32_t seq, int64_t timeout_us) {
+    int64_t deadline = seq_time_us() + timeout_us;
+    while (!cpu1_done(seq)) {
+        if (seq_time_us() > deadline) {
+            return false;
+        }
+        seq_spin();
+    }
+    return true;
+}
+
+int64_t cpu1_cycle_wait_us() {
+    seq_lock(&mailbox_mux);
+    uint32_t pace = pace_set > pace_prev ? pace_set : pace_prev;
+    uint8_t bank = set_bank;
+    seq_unlock(&mailbox_mux);
+
+    uint64_t cycles = bank_cycle_cycles(active_bank, pace);
+    uint64_t requested = bank_cycle_cycles(bank, pace);
+    if (requested > cycles) {
+        cycles = requested;
+    }
+    return CPU1_WAIT_SLACK_US + cycles / (seq_cpu_hz() / 1000000);
+}
+
+bool cpu1_request_stats() {
+    if (stats_seq != 0 && !cpu1_done(stats_seq)) {
+        return true;
+    }
+    cpu1_cmd_t cmd = {.op = CPU1_READ_STATS, .stats = &stats_snapshot};
+    uint32_t seq = cpu1_submit(&cmd, 1, NULL, NULL);
+    ERR_ON(seq == 0, return false);
+    stats_seq = seq;
+    return true;
+}
+
+bool cpu1_fetch_stats(cpu1_stats_t *stats) {
+    if (stats_seq == 0 || !cpu1_done(stats_seq)) {
+        return false;
+    }
+    seq_memw();
+    *stats = stats_snapshot;
+    return true;
+}
+
+bool cpu1_read_stats(cpu1_stats_t *stats) {
+    ERR_ON(!cpu1_request_stats(), return false);
+    ERR_ON(!cpu1_wait(stats_seq, cpu1_cycle_wait_us()), return false);
+    return cpu1_fetch_stats(stats);
+}
+
+void cpu1_print_stats(const cpu1_stats_t *stats) {
+    uint32_t avg = 0;
+    if (stats->periods != 0) {
+        avg = stats->period_total / stats->periods;
+    }
+    printf("cpu1: bank %u pages %u period %u/%u/%u switches %u stalls %u "
+           "late %u jitter %u wakeups %u\n",
+           stats->active_bank, stats->pages, stats->period_min, avg,
+           stats->period_max, stats->bank_switches, stats->stalls,
+           stats->timed_late_pages, stats->timed_worst_jitter,
+           stats->wakeups);
+    for (int i = 0; i < CPU1_HIST_BUCKETS; i++) {
+        if (stats->period_hist[i] != 0) {
+            printf("cpu1:   >= %6u cycles: %u\n",
+                   i == 0 ? 0 : 1U << (i + CPU1_HIST_SHIFT),
+                   stats->period_hist[i]);
+        }
+    }
+}
+
+uint32_t request_bank(uint8_t bank, cpu1_done_cb_t cb, void *arg) {
+    cpu1_cmd_t cmd = {.op = CPU1_SWAP_BANK, .bank = bank};
+    return cpu1_submit(&cmd, 1, cb, arg);
+}
+
+void IRAM_ATTR wake_app_cpu() {
+    seq_memw();
+    if (!app_cpu_parked) {
+        return;
+    }
+
+    // The APP cpu may have flagged itself parked and still be a few
+    // instructions away from gating its clock. Either it finds the new work
+    // and clears the flag, or the gate bit drops and it can be ungated.
+    while (app_cpu_parked && seq_running()) {
+        seq_spin();
+    }
+    if (!app_cpu_parked) {
+        return;
+    }
+
+    seq_lock(&mailbox_mux);
+    wake.pending = true;
+    wake.wakeups = app_cpu_wakeups;
+    wake.req_ccount = seq_ccount();
+    seq_resume();
+    seq_unlock(&mailbox_mux);
+}
+
+void get_app_cpu_wake_latency(uint32_t *last_cycles, uint32_t *max_cycles) {
+    seq_lock(&mailbox_mux);
+    if (last_cycles != NULL) {
+        *last_cycles = wake.last_cycles;
+    }
+    if (max_cycles != NULL) {
+        *max_cycles = wake.max_cycles;
+    }
+    seq_unlock(&mailbox_mux);
+}
+
+void get_bank_switch_latency(uint32_t *last_cycles, uint32_t *max_cycles) {
+    seq_lock(&mailbox_mux);
+    if (last_cycles != NULL) {
+        *last_cycles = last_switch_cycles;
+    }
+    if (max_cycles != NULL) {
+        *max_cycles = max_switch_cycles;
+    }
+    seq_unlock(&mailbox_mux);
+}
+
+bool set_active_bank(uint8_t bank) {
+    if (bank == active_bank && bank == set_bank) {
+        return true;
+    }
+
+    uint32_t seq = request_bank(bank, NULL, NULL);
+    ERR_ON(seq == 0, return false);
+
+    // The APP cpu picks the request up at the end of the current page cycle.
+    ERR_ON(!cpu1_wait(seq, cpu1_cycle_wait_us()), return false);
+    return true;
+}
+
+bool set_pacing(uint32_t pace_cycles) {
+    cpu1_cmd_t cmd = {.op = CPU1_SET_PACING, .pace_cycles = pace_cycles};
+    uint32_t seq = cpu1_submit(&cmd, 1, NULL, NULL);
+    ERR_ON(seq == 0, return false);
+    ERR_ON(!cpu1_wait(seq, cpu1_cycle_wait_us()), return false);
+    return true;
+}
+
+static inline bool bank_live(uint8_t bank) {
+    return bank == active_bank || bank == set_bank;
+}
+
+static bool check_write(uint8_t bank, uint8_t offset, uint8_t len,
+                        const void *values) {
+    ERR_ON(pattern_format == PATTERN_RLE, return false);
     ERR_ON(bank >= banks, return false);
     ERR_ON(offset > pages, return false);
     ERR_ON(offset + len > pages, return false);
     ERR_ON(offset + len < offset, return false);
     ERR_ON(values == NULL, return false);
-    ERR_ON(bankset == NULL, return false);
+    ERR_ON(arena == NULL, return false);
+    return true;
+}
+
+bool write_bank(bool set, uint8_t bank, uint8_t offset, uint8_t len,
+                uint32_t *values) {
+    ERR_ON(!check_write(bank, offset, len, values), return false);
+
+    if (bank_live(bank)) {
+        return patch_pages(bank, offset, len, set ? PATCH_SET : PATCH_CLEAR,
+                           values, 1, NULL, NULL) != 0;
+    }
 
     for (int i = offset; i < offset + len; i++) {
-        bankset[bank][i] = values[i - offset];
+        volatile gpio_page_t *page = page_at(bank, i);
+        if (set) {
+            page->set = values[i - offset];
+        } else {
+            page->clear = values[i - offset];
+        }
     }
     return true;
 }
 
+bool write_timed_bank(uint8_t bank, uint8_t offset, uint8_t len,
+                      const timed_page_t *values) {
+    ERR_ON(pattern_format != PATTERN_TIMED, return false);
+    ERR_ON(!check_write(bank, offset, len, values), return false);
+
+    if (bank_live(bank)) {
+        return patch_pages(bank, offset, len, PATCH_TIMED_PAGE,
+                           (const uint32_t *)values,
+                           sizeof(timed_page_t) / sizeof(uint32_t), NULL,
+                           NULL) != 0;
+    }
+
+    for (int i = offset; i < offset + len; i++) {
+        volatile timed_page_t *page =
+            (volatile timed_page_t *)page_at(bank, i);
+        const timed_page_t *v = &values[i - offset];
+        ERR_ON(v->cycles < TIMED_PAGE_MIN_CYCLES, return false);
+        page->set = v->set;
+        page->clear = v->clear;
+        page->cycles = v->cycles;
+    }
+    return true;
+}
+
+bool write_rle_bank(uint8_t bank, const uint32_t *prog, uint16_t words) {
+    ERR_ON(pattern_format != PATTERN_RLE, return false);
+    ERR_ON(bank >= banks, return false);
+    ERR_ON(prog == NULL, return false);
+    ERR_ON(words > bank_words, return false);
+    ERR_ON(arena == NULL, return false);
+    ERR_ON(!rle_validate(prog, words), return false);
+    // The decoder keeps loop pointers into the program across a cycle, so a
+    // playing program is never rewritten in place.
+    ERR_ON(bank_live(bank), return false);
+
+    volatile uint32_t *dst = prog_at(bank);
+    for (uint16_t i = 0; i < words; i++) {
+        dst[i] = prog[i];
+    }
+    return true;
+}
+
+void get_timed_jitter(uint32_t *worst_cycles, uint32_t *late_pages) {
+    if (worst_cycles != NULL) {
+        *worst_cycles = timed_worst_jitter;
+    }
+    if (late_pages != NULL) {
+        *late_pages = timed_late_pages;
+    }
+}
+
+void reset_timed_jitter() {
+    cpu1_cmd_t cmd = {.op = CPU1_RESET_STATS};
+    cpu1_submit(&cmd, 1, NULL, NULL);
+}
+
 bool write_set_bank(uint8_t bank, uint8_t offset, uint8_t len,
                     uint32_t *values) {
-    return write_bank(w1ts, bank, offset, len, values);
+    return write_bank(true, bank, offset, len, values);
 }
 
 bool write_clear_bank(uint8_t bank, uint8_t offset, uint8_t len,
                       uint32_t *values) {
-    return write_bank(w1tc, bank, offset, len, values);
+    return write_bank(false, bank, offset, len, values);
 }
 
-void deinit_gpios() {
-    set_active_bank(0xFF);
+static void free_arena() {
+    if (arena_raw != NULL) {
+        seq_free(arena_raw);
+    }
+    arena_raw = NULL;
+    arena = NULL;
+    arena_capacity = 0;
+}
 
-    if (w1ts != NULL) {
-        for (uint8_t i = 0; i < banks; i++) {
-            if (w1ts[i] != NULL) {
-                free((void *)(w1ts[i]));
-                w1ts[i] = NULL;
-            }
-        }
-        free((void *)w1ts);
-        w1ts = NULL;
+// IRAM only allows 32 bit accesses, so the arena is never touched with
+// memset/calloc.
+static bool alloc_arena(size_t size, pattern_mem_t mem) {
+    if (arena != NULL && mem == arena_mem && size <= arena_capacity) {
+        // Reuse the existing block rather than churning the heap.
+        goto clear;
     }
+    free_arena();
 
-    if (w1tc != NULL) {
-        for (uint8_t i = 0; i < banks; i++) {
-            if (w1tc[i] != NULL) {
-                free(((void *)(w1tc[i])));
-                w1tc[i] = NULL;
-            }
-        }
-        free((void *)w1tc);
-        w1tc = NULL;
+    bool exec = mem == PATTERN_MEM_IRAM;
+    arena_raw = seq_alloc(size + PATTERN_ARENA_ALIGN, exec);
+    if (arena_raw == NULL && mem == PATTERN_MEM_IRAM) {
+        printf("%s: no IRAM for %u bytes, using DRAM\n", __FUNCTION__,
+               (unsigned)size);
+        mem = PATTERN_MEM_DRAM;
+        arena_raw = seq_alloc(size + PATTERN_ARENA_ALIGN, false);
     }
+    ERR_ON(arena_raw == NULL, return false);
 
+    arena = (void *)(((uintptr_t)arena_raw + PATTERN_ARENA_ALIGN - 1) &
+                     ~(uintptr_t)(PATTERN_ARENA_ALIGN - 1));
+    arena_capacity = size;
+    arena_mem = mem;
+
+clear:
+    for (size_t i = 0; i < arena_capacity / sizeof(uint32_t); i++) {
+        ((volatile uint32_t *)arena)[i] = 0;
+    }
+    return true;
+}
+
+// False if the APP cpu didn't let go of the bank in time. It may still be
+// reading pages then, so the arena has to stay, as capture_stop() keeps its
+// buffer.
+static bool stop_gpios() {
+    ERR_ON(!set_active_bank(0xFF), return false);
     banks = 0;
     pages = 0;
+    bank_words = 0;
+    return true;
 }
 
-bool init_gpios(uint8_t new_banks, uint8_t new_pages) {
-    deinit_gpios();
+bool deinit_gpios() {
+    ERR_ON(!stop_gpios(), return false);
+    free_arena();
+    return true;
+}
+
+// len is pages per bank, or words per bank for PATTERN_RLE.
+static bool setup_gpios(uint8_t new_banks, uint16_t len, pattern_mem_t mem,
+                        pattern_format_t fmt) {
+    ERR_ON(!stop_gpios(), return false);
     ERR_ON(new_banks < 2, goto fail);
     ERR_ON(new_banks == 0xFF, goto fail);
+    ERR_ON(fmt != PATTERN_RLE && len > 0xFF, goto fail);
 
-    w1ts = calloc(new_banks, sizeof(uint32_t *));
-    w1tc = calloc(new_banks, sizeof(uint32_t *));
-    ERR_ON(w1ts == NULL || w1tc == NULL, goto fail);
+    uint8_t new_page_size = sizeof(gpio_page_t);
+    if (fmt == PATTERN_TIMED) {
+        new_page_size = sizeof(timed_page_t);
+    } else if (fmt == PATTERN_RLE) {
+        new_page_size = sizeof(uint32_t);
+    }
+    ERR_ON(!alloc_arena((size_t)new_banks * len * new_page_size, mem),
+           goto fail);
 
-    for (uint8_t i = 0; i < new_banks; i++) {
-        w1ts[i] = calloc(new_pages, sizeof(uint32_t));
-        w1tc[i] = calloc(new_pages, sizeof(uint32_t));
-        ERR_ON(w1ts[i] == NULL || w1tc[i] == NULL, goto fail);
+    if (fmt == PATTERN_TIMED) {
+        // Zero length pages would stall the sequencer at full speed, so
+        // every page starts at the minimum.
+        for (size_t i = 0; i < (size_t)new_banks * len; i++) {
+            ((volatile timed_page_t *)arena)[i].cycles =
+                TIMED_PAGE_MIN_CYCLES;
+        }
     }
+    // A zeroed RLE bank decodes as an empty cycle, which just polls the
+    // mailbox until something is written.
+    pattern_format = fmt;
+    page_size = new_page_size;
     banks = new_banks;
-    pages = new_pages;
-    launch_cpu1();
+    pages = fmt == PATTERN_RLE ? 0 : len;
+    bank_words = fmt == PATTERN_RLE ? len : 0;
+
+    start_app_cpu();
     return true;
 
 fail:
@@ -155,27 +656,109 @@ fail:
     return false;
 }
 
-static void IRAM_ATTR app_cpu_main(void) {
-    uint8_t this_bank = set_bank;
-    uint8_t idx = 0;
-    while (1) {
-        while (this_bank != 0xFF) {
-            if (idx == pages) {
-                this_bank = set_bank;
-                idx = 0;
-                active_bank = this_bank;
-            }
-            GPIO.out_w1ts = w1ts[this_bank][idx];
-            GPIO.out_w1tc = w1tc[this_bank][idx];
-            idx++;
-            cpu1_counter++;
-        }
-        this_bank = set_bank;
-        // TODO, do something to sleep to not just
-        // burn power.
+bool init_gpios_in(uint8_t new_banks, uint8_t new_pages, pattern_mem_t mem) {
+    return setup_gpios(new_banks, new_pages, mem, PATTERN_FLAT);
+}
+
+bool init_gpios(uint8_t new_banks, uint8_t new_pages) {
+    return init_gpios_in(new_banks, new_pages, PATTERN_MEM_DRAM);
+}
+
+bool init_gpios_timed(uint8_t new_banks, uint8_t new_pages,
+                      pattern_mem_t mem) {
+    return setup_gpios(new_banks, new_pages, mem, PATTERN_TIMED);
+}
+
+bool init_gpios_rle(uint8_t new_banks, uint16_t words_per_bank,
+                    pattern_mem_t mem) {
+    ERR_ON(words_per_bank < 4, return false);
+    return setup_gpios(new_banks, words_per_bank, mem, PATTERN_RLE);
+}
+
+// A stop that timed out stays queued, and the APP cpu keeps writing the ring
+// until it is applied. Retries wait on it instead of queueing another, and
+// the ring is only freed once it has landed.
+static uint32_t capture_stop_seq = 0;
+
+bool capture_stop() {
+    if (capture.buf == NULL) {
+        return true;
+    }
+
+    if (capture_stop_seq == 0) {
+        cpu1_cmd_t cmd = {.op = CPU1_CAPTURE_STOP};
+        capture_stop_seq = cpu1_submit(&cmd, 1, NULL, NULL);
+        ERR_ON(capture_stop_seq == 0, return false);
     }
+    ERR_ON(!cpu1_wait(capture_stop_seq, cpu1_cycle_wait_us()), return false);
+    capture_stop_seq = 0;
+
+    seq_free((void *)capture.buf);
+    capture.buf = NULL;
+    return true;
 }
 
+bool capture_start(const capture_config_t *cfg) {
+    ERR_ON(cfg == NULL, return false);
+    ERR_ON(cfg->samples < 2, return false);
+    ERR_ON(cfg->samples & (cfg->samples - 1), return false);
+    ERR_ON(cfg->mode == CAPTURE_PERIODIC && cfg->period_cycles == 0,
+           return false);
+    ERR_ON(cfg->mode == CAPTURE_EDGE &&
+               (cfg->trig_mask | cfg->trig1_mask) == 0,
+           return false);
+    ERR_ON(!capture_stop(), return false);
+
+    capture.buf = seq_alloc(cfg->samples * sizeof(capture_sample_t), false);
+    ERR_ON(capture.buf == NULL, return false);
+
+    capture.cfg = *cfg;
+    capture.mask = cfg->samples - 1;
+    capture.head = 0;
+    capture.tail = 0;
+    capture.samples = 0;
+    capture.overflows = 0;
+
+    cpu1_cmd_t cmd = {.op = CPU1_CAPTURE_START};
+    if (cpu1_submit(&cmd, 1, NULL, NULL) == 0) {
+        seq_free((void *)capture.buf);
+        capture.buf = NULL;
+        return false;
+    }
+    return true;
+}
+
+size_t capture_drain(capture_sample_t *out, size_t max) {
+    if (capture.buf == NULL) {
+        return 0;
+    }
+
+    uint32_t tail = capture.tail;
+    uint32_t avail = capture.head - tail;
+    seq_memw();
+    if (avail > max) {
+        avail = max;
+    }
+
+    for (uint32_t i = 0; i < avail; i++) {
+        volatile capture_sample_t *sample =
+            &capture.buf[(tail + i) & capture.mask];
+        out[i].in = sample->in;
+        out[i].in1 = sample->in1;
+        out[i].dt = sample->dt;
+    }
+    seq_memw();
+    capture.tail = tail + avail;
+    return avail;
+}
+
+void capture_get_stats(capture_stats_t *stats) {
+    stats->samples = capture.samples;
+    stats->overflows = capture.overflows;
+    stats->pending = capture.head - capture.tail;
+}
+
+#ifndef SEQUENCER_HOST
 static void IRAM_ATTR app_cpu_init() {
     // Reset the reg window. This will shift the A* registers around,
     // so we must do this in a separate ASM block.
@@ -190,18 +773,23 @@ static void IRAM_ATTR app_cpu_init() {
     asm volatile(
         "l32i a1, %0, 0\n"
         "callx4   %1\n" ::"r"(&app_cpu_stack_ptr),
-        "r"(app_cpu_main));
+        "r"(sequencer_main));
     DPORT_REG_CLR_BIT(DPORT_APPCPU_CTRL_B_REG, DPORT_APPCPU_CLKGATE_EN);
 }
 
 void launch_cpu1() {
-    if (DPORT_REG_GET_BIT(DPORT_APPCPU_CTRL_B_REG, DPORT_APPCPU_CLKGATE_EN)) {
+    if (app_cpu_parked ||
+        DPORT_REG_GET_BIT(DPORT_APPCPU_CTRL_B_REG, DPORT_APPCPU_CLKGATE_EN)) {
         printf("APP CPU is already running!\n");
         return;
     }
 
     if (!app_cpu_stack_ptr) {
-        app_cpu_stack_ptr = heap_caps_malloc(1024, MALLOC_CAP_DMA);
+        // The stack grows down, so start at the (16 byte aligned) top.
+        uint8_t *stack = heap_caps_malloc(APP_CPU_STACK_SIZE, MALLOC_CAP_DMA);
+        ERR_ON(stack == NULL, return);
+        app_cpu_stack_ptr =
+            (void *)((uintptr_t)(stack + APP_CPU_STACK_SIZE) & ~0xFUL);
     }
 
     DPORT_REG_SET_BIT(DPORT_APPCPU_CTRL_A_REG, DPORT_APPCPU_RESETTING);
@@ -210,4 +798,5 @@ void launch_cpu1() {
     printf("Start APP CPU at %08X\n", (uint32_t)&app_cpu_init);
     ets_set_appcpu_boot_addr((uint32_t)&app_cpu_init);
     DPORT_REG_SET_BIT(DPORT_APPCPU_CTRL_B_REG, DPORT_APPCPU_CLKGATE_EN);
-}
\ No newline at end of file
+}
+#endif
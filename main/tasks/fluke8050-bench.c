@@ -0,0 +1,111 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fluke8050-bench.h"
+
+#include "esp32/clk.h"
+#include "esp_log.h"
+#include "fluke8050-bus.h"
+#include "fluke8050-decoder.h"
+#include "inttypes.h"
+#include "xtensa/core-macros.h"
+
+#define BENCH_SCANS 16
+// Strobe up and down for each latch.
+#define SAMPLES_PER_SCAN (FLUKE8050_STROBES * 2)
+
+static const char *TAG = "fluke8050-bench";
+
+// Strobes on GPIO0-27, seven per meter. Data on GPIO32-35, 36-39 and 28-31;
+// the fourth meter shares the third's data lines, which only makes it
+// dearer to decode.
+static const uint8_t data_base[FLUKE8050_MAX_METERS] = {32, 36, 28, 28};
+
+static capture_sample_t
+    samples[BENCH_SCANS * SAMPLES_PER_SCAN * FLUKE8050_MAX_METERS];
+static fluke8050_decoder_t decoders[FLUKE8050_MAX_METERS];
+
+static void set_pin(capture_sample_t *s, uint8_t pin, bool level) {
+    if (pin < 32) {
+        s->in = level ? s->in | (1UL << pin) : s->in & ~(1UL << pin);
+    } else {
+        uint8_t bit = 1 << (pin - 32);
+        s->in1 = level ? s->in1 | bit : s->in1 & ~bit;
+    }
+}
+
+static void set_data(capture_sample_t *s, uint8_t meter, uint8_t nibble) {
+    for (int b = 0; b < 4; b++) {
+        set_pin(s, data_base[meter] + b, nibble & (1 << b));
+    }
+}
+
+// Meters take turns a latch at a time, as unsynchronised meters would
+// roughly interleave. Returns the sample count.
+static size_t make_samples(uint8_t meters) {
+    capture_sample_t s = {0};
+    size_t n = 0;
+    for (int scan = 0; scan < BENCH_SCANS; scan++) {
+        for (int latch = 0; latch < FLUKE8050_STROBES; latch++) {
+            for (int m = 0; m < meters; m++) {
+                set_data(&s, m, (scan + latch) & 0x7);
+                set_pin(&s, m * FLUKE8050_STROBES + latch, true);
+                s.dt = 240;
+                samples[n++] = s;
+                set_pin(&s, m * FLUKE8050_STROBES + latch, false);
+                samples[n++] = s;
+            }
+        }
+    }
+    return n;
+}
+
+void fluke8050_decode_benchmark() {
+    uint32_t cpu_hz = esp_clk_cpu_freq();
+    for (uint8_t meters = 1; meters <= FLUKE8050_MAX_METERS; meters++) {
+        for (int m = 0; m < meters; m++) {
+            uint8_t strobes[FLUKE8050_STROBES];
+            uint8_t data[4];
+            for (int i = 0; i < FLUKE8050_STROBES; i++) {
+                strobes[i] = m * FLUKE8050_STROBES + i;
+            }
+            for (int b = 0; b < 4; b++) {
+                data[b] = data_base[m] + b;
+            }
+            fluke8050_decoder_init(&decoders[m], strobes, data, 0);
+        }
+        size_t n = make_samples(meters);
+
+        uint32_t scans = 0;
+        uint32_t start = XTHAL_GET_CCOUNT();
+        for (size_t i = 0; i < n; i++) {
+            for (int m = 0; m < meters; m++) {
+                fluke8050_reading_t r;
+                if (fluke8050_decode(&decoders[m], &samples[i], &r)) {
+                    scans++;
+                }
+            }
+        }
+        uint32_t cycles = XTHAL_GET_CCOUNT() - start;
+
+        ESP_LOGI(TAG,
+                 "%u meters: %" PRIu32 " cycles per sample, %" PRIu32
+                 " scans/s per meter at most",
+                 meters, cycles / (uint32_t)n,
+                 scans ? (uint32_t)((uint64_t)cpu_hz * scans / cycles /
+                                    meters)
+                       : 0);
+    }
+}
@@ -0,0 +1,301 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fluke8050-bus.h"
+
+#include "driver/gpio.h"
+#include "esp32/clk.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "fluke8050-decoder.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#define BUS_BATCH 64
+#define BUS_RATE_US 1000000
+
+static const char *TAG = "fluke8050-bus";
+
+typedef struct meter_data {
+    fluke8050_decoder_t decoder;
+    QueueHandle_t latest;
+    uint32_t readings;
+    reading_history_t history;
+    uint32_t rate_readings;
+    uint32_t scan_rate;
+} meter_data_t;
+
+typedef struct bus_data {
+    uint8_t meters;
+    meter_data_t meter[FLUKE8050_MAX_METERS];
+    TaskHandle_t task;
+    uint32_t cpu_mhz;
+    void (*listener)(void *arg);
+    void *listener_arg;
+
+    // Rate window, only ever moved by the bus task.
+    int64_t rate_time;
+    uint32_t rate_samples;
+    uint32_t sample_rate;
+} bus_data_t;
+
+static bus_data_t *bus = NULL;
+
+// Split evenly between the meters.
+static history_sample_t history_samples[FLUKE8050_HISTORY_SAMPLES];
+static portMUX_TYPE history_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void record(meter_data_t *m, const fluke8050_reading_t *r) {
+    int32_t value;
+    if (!fluke8050_reading_value(r, &value)) {
+        return;
+    }
+    portENTER_CRITICAL(&history_mux);
+    history_push(&m->history, r->time_us / 1000, value);
+    portEXIT_CRITICAL(&history_mux);
+}
+
+// Measured over BUS_RATE_US by the bus task alone, so every reader of
+// fluke8050_bus_get_stats() sees the same figures.
+static void update_rates(bus_data_t *b) {
+    int64_t now = esp_timer_get_time();
+    int64_t span = now - b->rate_time;
+    if (span < BUS_RATE_US) {
+        return;
+    }
+    capture_stats_t cs;
+    capture_get_stats(&cs);
+    b->sample_rate =
+        (uint64_t)(cs.samples - b->rate_samples) * 1000000ULL / span;
+    b->rate_samples = cs.samples;
+    for (int id = 0; id < b->meters; id++) {
+        meter_data_t *m = &b->meter[id];
+        uint32_t readings = m->readings;
+        m->scan_rate =
+            (uint64_t)(readings - m->rate_readings) * 1000000ULL / span;
+        m->rate_readings = readings;
+    }
+    b->rate_time = now;
+}
+
+// Every meter's decoder sees every sample; one whose pins didn't move
+// skips it after a compare, so decoding costs what the busiest meters
+// need rather than a pass per meter.
+//
+// Scans are stamped from the drain time, less the captured time that
+// followed them in the batch. dt saturates, so a stamp can only come out
+// late, never early.
+static void bus_worker(void *arg) {
+    bus_data_t *b = arg;
+    capture_sample_t batch[BUS_BATCH];
+
+    while (true) {
+        size_t n;
+        while ((n = capture_drain(batch, BUS_BATCH)) > 0) {
+            int64_t now = esp_timer_get_time();
+            // All decoders have seen the same samples, so the same cycles.
+            uint64_t batch_end = b->meter[0].decoder.cycles;
+            for (size_t i = 0; i < n; i++) {
+                batch_end += batch[i].dt;
+            }
+
+            bool published = false;
+            for (size_t i = 0; i < n; i++) {
+                for (int id = 0; id < b->meters; id++) {
+                    meter_data_t *m = &b->meter[id];
+                    fluke8050_reading_t r;
+                    if (!fluke8050_decode(&m->decoder, &batch[i], &r)) {
+                        continue;
+                    }
+                    r.seq = ++m->readings;
+                    r.time_us = now - (batch_end - m->decoder.end_cycles) /
+                                          b->cpu_mhz;
+                    xQueueOverwrite(m->latest, &r);
+                    record(m, &r);
+                    published = true;
+                }
+            }
+            if (published && b->listener != NULL) {
+                b->listener(b->listener_arg);
+            }
+        }
+        update_rates(b);
+        // The ring holds well over a tick of the meters' multiplexing.
+        vTaskDelay(1);
+    }
+}
+
+static bool start_meter(meter_data_t *m, const fluke8050_meter_config_t *mc,
+                        uint32_t max_gap_cycles, uint32_t history_len,
+                        history_sample_t *samples, capture_config_t *capture) {
+    if (!fluke8050_decoder_init(&m->decoder, mc->strobe_pins, mc->data_pins,
+                                max_gap_cycles)) {
+        ESP_LOGE(TAG, "bad pin map");
+        return false;
+    }
+
+    uint64_t pins = 0;
+    for (int i = 0; i < FLUKE8050_STROBES; i++) {
+        pins |= 1ULL << mc->strobe_pins[i];
+    }
+    for (int i = 0; i < 4; i++) {
+        pins |= 1ULL << mc->data_pins[i];
+    }
+    gpio_config_t io = {.pin_bit_mask = pins,
+                        .mode = GPIO_MODE_INPUT,
+                        .pull_up_en = GPIO_PULLUP_DISABLE,
+                        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+                        .intr_type = GPIO_INTR_DISABLE};
+    if (gpio_config(&io) != ESP_OK) {
+        ESP_LOGE(TAG, "gpio_config failed");
+        return false;
+    }
+
+    m->latest = xQueueCreate(1, sizeof(fluke8050_reading_t));
+    if (m->latest == NULL) {
+        ESP_LOGE(TAG, "Failed to create latest reading queue");
+        return false;
+    }
+    history_init(&m->history, samples, history_len);
+    fluke8050_decoder_capture(&m->decoder, capture);
+    return true;
+}
+
+bool fluke8050_bus_start(const fluke8050_bus_config_t *cfg) {
+    if (bus != NULL) {
+        ESP_LOGE(TAG, "already running");
+        return false;
+    }
+    if (cfg->meters == 0 || cfg->meters > FLUKE8050_MAX_METERS) {
+        ESP_LOGE(TAG, "%u meters, can do 1 to %u", cfg->meters,
+                 FLUKE8050_MAX_METERS);
+        return false;
+    }
+    bus = calloc(1, sizeof(bus_data_t));
+    if (bus == NULL) {
+        ESP_LOGE(TAG, "ENOMEM allocating bus data");
+        return false;
+    }
+    bus->cpu_mhz = esp_clk_cpu_freq() / 1000000;
+
+    capture_config_t capture = {.samples = cfg->samples};
+    uint32_t history_len = FLUKE8050_HISTORY_SAMPLES / cfg->meters;
+    for (int id = 0; id < cfg->meters; id++) {
+        if (!start_meter(&bus->meter[id], &cfg->meter[id],
+                         cfg->max_gap_us * bus->cpu_mhz, history_len,
+                         &history_samples[id * history_len], &capture)) {
+            ESP_LOGE(TAG, "meter %d not started", id);
+            goto fail;
+        }
+        bus->meters++;
+    }
+
+    if (!capture_start(&capture)) {
+        ESP_LOGE(TAG, "capture_start failed");
+        goto fail;
+    }
+    bus->rate_time = esp_timer_get_time();
+
+    if (xTaskCreate(bus_worker, TAG, 3 * 1024, bus, 4, &bus->task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create the bus task");
+        capture_stop();
+        goto fail;
+    }
+    return true;
+
+fail:
+    for (int id = 0; id < FLUKE8050_MAX_METERS; id++) {
+        if (bus->meter[id].latest != NULL) {
+            vQueueDelete(bus->meter[id].latest);
+        }
+    }
+    free(bus);
+    bus = NULL;
+    return false;
+}
+
+uint8_t fluke8050_bus_meters() { return bus ? bus->meters : 0; }
+
+bool fluke8050_bus_latest(uint8_t meter, fluke8050_reading_t *out) {
+    if (bus == NULL || meter >= bus->meters) {
+        return false;
+    }
+    return xQueuePeek(bus->meter[meter].latest, out, 0) == pdTRUE;
+}
+
+void fluke8050_bus_set_listener(void (*cb)(void *arg), void *arg) {
+    if (bus == NULL) {
+        return;
+    }
+    bus->listener_arg = arg;
+    bus->listener = cb;
+}
+
+void fluke8050_bus_get_stats(uint8_t meter, fluke8050_bus_stats_t *stats) {
+    capture_stats_t cs;
+    capture_get_stats(&cs);
+    bool valid = bus != NULL && meter < bus->meters;
+    stats->readings = valid ? bus->meter[meter].readings : 0;
+    stats->torn = valid ? bus->meter[meter].decoder.torn : 0;
+    stats->overflows = cs.overflows;
+    stats->sample_rate = bus != NULL ? bus->sample_rate : 0;
+    stats->scan_rate = valid ? bus->meter[meter].scan_rate : 0;
+}
+
+// Before fluke8050_bus_start() every meter has an empty history.
+static reading_history_t *history_of(uint8_t meter) {
+    static reading_history_t empty;
+    if (bus == NULL || meter >= bus->meters) {
+        return &empty;
+    }
+    return &bus->meter[meter].history;
+}
+
+void fluke8050_bus_history_stats(uint8_t meter, history_stats_t *stats) {
+    reading_history_t *h = history_of(meter);
+    portENTER_CRITICAL(&history_mux);
+    *stats = h->stats;
+    portEXIT_CRITICAL(&history_mux);
+}
+
+void fluke8050_bus_history_span(uint8_t meter, uint32_t *first,
+                                uint32_t *total) {
+    reading_history_t *h = history_of(meter);
+    portENTER_CRITICAL(&history_mux);
+    *first = history_first(h);
+    *total = h->total;
+    portEXIT_CRITICAL(&history_mux);
+}
+
+size_t fluke8050_bus_history_copy(uint8_t meter, uint32_t from,
+                                  history_sample_t *out, size_t max,
+                                  uint32_t *next) {
+    reading_history_t *h = history_of(meter);
+    portENTER_CRITICAL(&history_mux);
+    size_t n = history_copy(h, from, out, max, next);
+    portEXIT_CRITICAL(&history_mux);
+    return n;
+}
+
+void fluke8050_bus_history_reset(uint8_t meter) {
+    reading_history_t *h = history_of(meter);
+    if (h->capacity == 0) {
+        return;
+    }
+    portENTER_CRITICAL(&history_mux);
+    history_reset(h);
+    portEXIT_CRITICAL(&history_mux);
+}
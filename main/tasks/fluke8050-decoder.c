@@ -0,0 +1,208 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fluke8050-decoder.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NO_LATCH FLUKE8050_STROBES
+
+bool fluke8050_decoder_init(fluke8050_decoder_t *d,
+                            const uint8_t strobe_pins[FLUKE8050_STROBES],
+                            const uint8_t data_pins[4],
+                            uint32_t max_gap_cycles) {
+    memset(d, 0, sizeof(*d));
+    for (int i = 0; i < FLUKE8050_STROBES; i++) {
+        if (strobe_pins[i] > 39) {
+            return false;
+        }
+        if (strobe_pins[i] < 32) {
+            d->strobe_in[i] = 1UL << strobe_pins[i];
+        } else {
+            d->strobe_in1[i] = 1 << (strobe_pins[i] - 32);
+        }
+    }
+    for (int b = 0; b < 4; b++) {
+        if (data_pins[b] > 39) {
+            return false;
+        }
+        if (data_pins[b] < 32) {
+            d->data_in[b] = 1UL << data_pins[b];
+        }
+    }
+
+    // Whatever order the data lines on GPIO32-39 are wired in, one lookup
+    // gives their part of the BCD value.
+    for (int raw = 0; raw < 256; raw++) {
+        uint8_t nibble = 0;
+        for (int b = 0; b < 4; b++) {
+            if (data_pins[b] >= 32 && (raw & (1 << (data_pins[b] - 32)))) {
+                nibble |= 1 << b;
+            }
+        }
+        d->data_lut[raw] = nibble;
+    }
+
+    for (int i = 0; i < FLUKE8050_STROBES; i++) {
+        d->in_mask |= d->strobe_in[i];
+        d->in1_mask |= d->strobe_in1[i];
+    }
+    for (int b = 0; b < 4; b++) {
+        d->in_mask |= d->data_in[b];
+    }
+    for (int raw = 1; raw < 256; raw <<= 1) {
+        if (d->data_lut[raw] != 0) {
+            d->in1_mask |= raw;
+        }
+    }
+
+    d->max_gap_cycles = max_gap_cycles;
+    d->active = NO_LATCH;
+    return true;
+}
+
+void fluke8050_decoder_capture(const fluke8050_decoder_t *d,
+                               capture_config_t *cfg) {
+    cfg->mode = CAPTURE_EDGE;
+    cfg->in_mask |= d->in_mask;
+    cfg->in1_mask |= d->in1_mask;
+    cfg->trig_mask |= d->in_mask;
+    cfg->trig1_mask |= d->in1_mask;
+}
+
+static void drop_scan(fluke8050_decoder_t *d) {
+    if (d->next != 0) {
+        d->torn++;
+    }
+    d->next = 0;
+}
+
+// A latch has taken value. Returns true when that completes a scan.
+static bool latch(fluke8050_decoder_t *d, uint8_t idx, uint8_t value) {
+    if (idx == 0) {
+        drop_scan(d);
+    } else if (idx != d->next) {
+        drop_scan(d);
+        return false;
+    }
+    d->nibbles[idx] = value;
+    d->next++;
+    if (d->next < FLUKE8050_STROBES) {
+        return false;
+    }
+    d->next = 0;
+    d->frames++;
+    return true;
+}
+
+bool fluke8050_decode(fluke8050_decoder_t *d, const capture_sample_t *s,
+                      fluke8050_reading_t *out) {
+    d->cycles += s->dt;
+    uint32_t in = s->in & d->in_mask;
+    uint8_t in1 = s->in1 & d->in1_mask;
+    if (in == d->last_in && in1 == d->last_in1) {
+        // Another meter's edge.
+        return false;
+    }
+    d->last_in = in;
+    d->last_in1 = in1;
+    if (d->max_gap_cycles != 0 &&
+        d->cycles - d->change_cycles >= d->max_gap_cycles) {
+        drop_scan(d);
+    }
+    d->change_cycles = d->cycles;
+
+    uint8_t strobes = 0;
+    uint8_t idx = NO_LATCH;
+    for (int i = 0; i < FLUKE8050_STROBES; i++) {
+        if ((s->in & d->strobe_in[i]) || (s->in1 & d->strobe_in1[i])) {
+            strobes++;
+            idx = i;
+        }
+    }
+    uint8_t data = d->data_lut[in1];
+    for (int b = 0; b < 4; b++) {
+        if (in & d->data_in[b]) {
+            data |= 1 << b;
+        }
+    }
+
+    if (strobes > 1) {
+        // Two latches open at once, whatever either holds is suspect.
+        d->active = NO_LATCH;
+        drop_scan(d);
+        return false;
+    }
+
+    bool done = false;
+    if (d->active != NO_LATCH) {
+        if (idx == d->active) {
+            // Data moved under the strobe; the latch follows it.
+            d->data = data;
+            return false;
+        }
+        done = latch(d, d->active, d->data);
+    }
+    d->active = idx;
+    d->data = data;
+
+    if (!done) {
+        return false;
+    }
+    d->end_cycles = d->cycles;
+    out->indicator_mask = d->nibbles[LATCH_U10];
+    out->sign_mask = d->nibbles[LATCH_U11];
+    for (int i = 0; i < 4; i++) {
+        out->digits[i] = d->nibbles[LATCH_U12 + i];
+    }
+    out->decimal_mask = d->nibbles[LATCH_U16];
+    return true;
+}
+
+bool fluke8050_reading_value(const fluke8050_reading_t *r, int32_t *value) {
+    int32_t counts = r->sign_mask & SIGN_ONE ? 1 : 0;
+    for (int i = 0; i < 4; i++) {
+        if (r->digits[i] > CD4056_9) {
+            return false;
+        }
+        counts = counts * 10 + r->digits[i];
+    }
+
+    // The point sits left of its digit, so a point at digit i leaves 4 - i
+    // digits after it.
+    int32_t scale = FLUKE8050_VALUE_SCALE;
+    for (int i = 0; i < 4; i++) {
+        if (r->decimal_mask & BIT(i)) {
+            scale = 1;
+            while (i-- > 0) {
+                scale *= 10;
+            }
+            break;
+        }
+    }
+    *value = counts * scale;
+    if (r->sign_mask & SIGN_MINUS) {
+        *value = -*value;
+    }
+    return true;
+}
+
+int fluke8050_format_value(int32_t value, char *buf, size_t len) {
+    uint32_t mag = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    return snprintf(buf, len, "%s%" PRIu32 ".%04" PRIu32, value < 0 ? "-" : "",
+                    mag / FLUKE8050_VALUE_SCALE, mag % FLUKE8050_VALUE_SCALE);
+}
@@ -0,0 +1,167 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fluke8050-derived.h"
+
+#include "fluke8050-decoder.h"
+#include "math.h"
+#include "stdio.h"
+
+#define LOG2_TABLE_BITS 8
+#define LOG2_TABLE_SIZE (1 << LOG2_TABLE_BITS)
+
+// 20 log10(2) in 1/10000 dB per unit of log2.
+#define DB_PER_LOG2 60206
+// 20 log10(1000) in 1/10000 dB, taken off dB of a millivolt reading.
+#define DB_PER_MV 600000
+
+typedef struct ratio {
+    int32_t num;
+    int32_t den;
+    const char *name;
+} ratio_t;
+
+// Reference impedances the 8050A's own dB mode offers most often.
+static const uint16_t impedances[] = {8, 16, 50, 75, 150, 300, 600, 1000};
+#define IMPEDANCES (sizeof(impedances) / sizeof(impedances[0]))
+
+// Probe and shunt ratios.
+static const ratio_t ratios[] = {
+    {10, 1, "x10"}, {100, 1, "x100"}, {1000, 1, "x1000"}, {1, 1000, "/1000"}};
+#define RATIOS (sizeof(ratios) / sizeof(ratios[0]))
+
+// log2(1 + i / LOG2_TABLE_SIZE) in Q16, one extra entry to interpolate to.
+static uint32_t log2_table[LOG2_TABLE_SIZE + 1];
+// log2(FLUKE8050_VALUE_SCALE) in Q16, so values come out against 1 unit.
+static int32_t log2_unit;
+// 30 - 10 log10(R) in 1/10000 dB: dBm = dBV + this.
+static int32_t dbm_offset[IMPEDANCES];
+static bool tables_ready = false;
+
+void derived_init(derived_t *d) {
+    d->mode = DERIVED_OFF;
+    d->rel_ref = 0;
+    d->impedance = 6;  // 600R
+    d->ratio = 0;
+    d->unit = DERIVED_UNIT_NONE;
+    if (tables_ready) {
+        return;
+    }
+    for (int i = 0; i <= LOG2_TABLE_SIZE; i++) {
+        log2_table[i] =
+            lround(log2(1.0 + (double)i / LOG2_TABLE_SIZE) * 65536.0);
+    }
+    log2_unit = lround(log2(FLUKE8050_VALUE_SCALE) * 65536.0);
+    for (size_t i = 0; i < IMPEDANCES; i++) {
+        double db = 30.0 - 10.0 * log10(impedances[i]);
+        dbm_offset[i] = lround(db * FLUKE8050_VALUE_SCALE);
+    }
+    tables_ready = true;
+}
+
+int32_t derived_log2_q16(uint32_t x) {
+    int msb = 31 - __builtin_clz(x);
+    // Mantissa with its leading one at bit 31: the next 8 bits pick the
+    // table entry and the 16 after that interpolate.
+    uint32_t m = x << (31 - msb);
+    uint32_t idx = (m >> (31 - LOG2_TABLE_BITS)) & (LOG2_TABLE_SIZE - 1);
+    uint32_t frac = (m >> (31 - LOG2_TABLE_BITS - 16)) & 0xffff;
+    uint32_t lo = log2_table[idx];
+    uint32_t step = log2_table[idx + 1] - lo;
+    return (msb << 16) + lo + ((step * frac) >> 16);
+}
+
+void derived_set_mode(derived_t *d, derived_mode_t mode, int32_t current) {
+    d->mode = mode < DERIVED_MODES ? mode : DERIVED_OFF;
+    if (d->mode == DERIVED_REL) {
+        d->rel_ref = current;
+    }
+}
+
+// NONE, V, mV, V, ...
+static derived_unit_t next_unit(derived_unit_t unit) {
+    return unit == DERIVED_UNIT_V ? DERIVED_UNIT_MV : DERIVED_UNIT_V;
+}
+
+void derived_next_param(derived_t *d, int32_t current) {
+    if (d->mode == DERIVED_REL) {
+        d->rel_ref = current;
+    } else if (d->mode == DERIVED_DBV) {
+        d->unit = next_unit(d->unit);
+    } else if (d->mode == DERIVED_DBM) {
+        if (d->unit == DERIVED_UNIT_NONE) {
+            d->unit = DERIVED_UNIT_V;
+        } else if (d->impedance + 1U < IMPEDANCES) {
+            d->impedance++;
+        } else {
+            d->impedance = 0;
+            d->unit = next_unit(d->unit);
+        }
+    } else if (d->mode == DERIVED_SCALE) {
+        d->ratio = (d->ratio + 1) % RATIOS;
+    }
+}
+
+static int32_t dbv(const derived_t *d, int32_t value) {
+    uint32_t mag = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    int64_t l2 = derived_log2_q16(mag) - log2_unit;
+    int32_t db = (l2 * DB_PER_LOG2 + (1 << 15)) >> 16;
+    return d->unit == DERIVED_UNIT_MV ? db - DB_PER_MV : db;
+}
+
+bool derived_apply(const derived_t *d, int32_t value, int32_t *out) {
+    if (d->mode == DERIVED_REL) {
+        int64_t r = (int64_t)value - d->rel_ref;
+        *out = r;
+        return r >= INT32_MIN && r <= INT32_MAX;
+    } else if (d->mode == DERIVED_DBV) {
+        if (value == 0 || d->unit == DERIVED_UNIT_NONE) {
+            return false;
+        }
+        *out = dbv(d, value);
+        return true;
+    } else if (d->mode == DERIVED_DBM) {
+        if (value == 0 || d->unit == DERIVED_UNIT_NONE) {
+            return false;
+        }
+        *out = dbv(d, value) + dbm_offset[d->impedance];
+        return true;
+    } else if (d->mode == DERIVED_SCALE) {
+        const ratio_t *r = &ratios[d->ratio];
+        int64_t s = (int64_t)value * r->num / r->den;
+        *out = s;
+        return s >= INT32_MIN && s <= INT32_MAX;
+    }
+    return false;
+}
+
+static const char *unit_names[] = {"?", "V", "mV"};
+
+void derived_describe(const derived_t *d, char *buf, size_t len) {
+    if (d->mode == DERIVED_REL) {
+        char ref[16];
+        fluke8050_format_value(d->rel_ref, ref, sizeof(ref));
+        snprintf(buf, len, "REL %s", ref);
+    } else if (d->mode == DERIVED_DBV) {
+        snprintf(buf, len, "dBV %s", unit_names[d->unit]);
+    } else if (d->mode == DERIVED_DBM) {
+        snprintf(buf, len, "dBm %uR %s", impedances[d->impedance],
+                 unit_names[d->unit]);
+    } else if (d->mode == DERIVED_SCALE) {
+        snprintf(buf, len, "%s", ratios[d->ratio].name);
+    } else {
+        snprintf(buf, len, "off");
+    }
+}
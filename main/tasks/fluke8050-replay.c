@@ -0,0 +1,85 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fluke8050-replay.h"
+
+uint32_t fluke8050_replay_gpios(const fluke8050_meter_config_t *pins) {
+    uint32_t mask = 0;
+    for (int i = 0; i < FLUKE8050_STROBES; i++) {
+        if (pins->strobe_pins[i] > 31) {
+            return 0;
+        }
+        mask |= 1UL << pins->strobe_pins[i];
+    }
+    for (int b = 0; b < 4; b++) {
+        if (pins->data_pins[b] > 31) {
+            return 0;
+        }
+        mask |= 1UL << pins->data_pins[b];
+    }
+    return mask;
+}
+
+static uint32_t *put_page(uint32_t *p, uint32_t n, uint32_t set,
+                          uint32_t clear) {
+    *p++ = RLE_WORD(RLE_OP_PAGE, n);
+    *p++ = set;
+    *p++ = clear;
+    return p;
+}
+
+static uint8_t nibble_of(const fluke8050_reading_t *r, int latch) {
+    if (latch == LATCH_U10) {
+        return r->indicator_mask;
+    } else if (latch == LATCH_U11) {
+        return r->sign_mask;
+    } else if (latch == LATCH_U16) {
+        return r->decimal_mask;
+    }
+    return r->digits[latch - LATCH_U12];
+}
+
+size_t fluke8050_replay_compile(const fluke8050_reading_t *readings,
+                                size_t count,
+                                const fluke8050_meter_config_t *pins,
+                                uint32_t strobe_pages, uint32_t *out,
+                                size_t max_words) {
+    if (max_words < FLUKE8050_REPLAY_WORDS(count) || strobe_pages == 0 ||
+        strobe_pages > RLE_COUNT_MASK || fluke8050_replay_gpios(pins) == 0) {
+        return 0;
+    }
+
+    uint32_t *p = out;
+    for (size_t i = 0; i < count; i++) {
+        for (int latch = 0; latch < FLUKE8050_STROBES; latch++) {
+            uint8_t nibble = nibble_of(&readings[i], latch);
+            uint32_t ones = 0;
+            uint32_t zeros = 0;
+            for (int b = 0; b < 4; b++) {
+                if (nibble & BIT(b)) {
+                    ones |= 1UL << pins->data_pins[b];
+                } else {
+                    zeros |= 1UL << pins->data_pins[b];
+                }
+            }
+            uint32_t strobe = 1UL << pins->strobe_pins[latch];
+            p = put_page(p, 1, ones, zeros);
+            p = put_page(p, strobe_pages, strobe, 0);
+            p = put_page(p, 1, 0, strobe);
+        }
+    }
+    *p++ = RLE_WORD(RLE_OP_EOP, 0);
+    return p - out;
+}
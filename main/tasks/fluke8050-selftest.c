@@ -0,0 +1,285 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fluke8050-selftest.h"
+
+#include "driver/gpio.h"
+#include "esp32-cpu1.h"
+#include "esp32/clk.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "fluke8050-decoder.h"
+#include "fluke8050-replay.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "inttypes.h"
+
+#define SELFTEST_READINGS 16
+#define SELFTEST_STROBE_PAGES 2
+#define SELFTEST_BATCH 64
+#define SELFTEST_MS 500
+// Slowest pacing tried, in CPU cycles per page. Halved down to free running.
+#define SELFTEST_SLOWEST_PACE 24000
+#define SELFTEST_FASTEST_PACE 16
+// Whole program cycles a run should at least see; the sweep starts faster
+// than SELFTEST_SLOWEST_PACE if they would not fit in SELFTEST_MS.
+#define SELFTEST_MIN_CYCLES 8
+#define SELFTEST_CYCLE_PAGES \
+    FLUKE8050_REPLAY_PAGES(SELFTEST_READINGS, SELFTEST_STROBE_PAGES)
+
+static const char *TAG = "fluke8050-selftest";
+
+static fluke8050_reading_t readings[SELFTEST_READINGS];
+static uint32_t prog[FLUKE8050_REPLAY_WORDS(SELFTEST_READINGS)];
+
+typedef struct selftest_run {
+    uint32_t pace;
+    int64_t elapsed_us;
+    uint32_t pages;
+    uint32_t scans;   // Decoded and the reading that was played
+    uint32_t errors;  // Decoded but not the reading that was played
+    uint32_t torn;
+    uint32_t overflows;
+    int64_t latency_min_us;
+    int64_t latency_max_us;
+    int64_t latency_total_us;
+} selftest_run_t;
+
+// Every latch changes from one reading to the next.
+static void make_readings() {
+    for (int i = 0; i < SELFTEST_READINGS; i++) {
+        fluke8050_reading_t *r = &readings[i];
+        r->indicator_mask = i & 0xf;
+        r->sign_mask = SIGN_BP | (i & 1 ? SIGN_MINUS : SIGN_PLUS) |
+                       (i & 2 ? SIGN_ONE : 0);
+        for (int d = 0; d < 4; d++) {
+            r->digits[d] = (i * 7 + d * 3) % 10;
+        }
+        r->decimal_mask = BIT(i % 4);
+    }
+}
+
+static bool same_reading(const fluke8050_reading_t *a,
+                         const fluke8050_reading_t *b) {
+    if (a->indicator_mask != b->indicator_mask ||
+        a->sign_mask != b->sign_mask || a->decimal_mask != b->decimal_mask) {
+        return false;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (a->digits[i] != b->digits[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void discard_capture() {
+    capture_sample_t batch[SELFTEST_BATCH];
+    while (capture_drain(batch, SELFTEST_BATCH) > 0) {
+    }
+}
+
+// Plays the readings for SELFTEST_MS, draining and decoding once a tick as
+// the bus task does. Latency is from the scan's last strobe, dated from the
+// captured dt like the bus task's stamps, to the decode. False if the bank
+// could not be started or stopped.
+static bool run(const fluke8050_decoder_t *fresh, uint32_t cpu_mhz,
+                selftest_run_t *out) {
+    fluke8050_decoder_t d = *fresh;
+    capture_sample_t batch[SELFTEST_BATCH];
+    capture_stats_t before, after;
+    size_t expect = 0;
+
+    capture_get_stats(&before);
+    uint32_t pages = cpu1_counter;
+    int64_t start = esp_timer_get_time();
+    if (!set_active_bank(0)) {
+        ESP_LOGE(TAG, "pace %" PRIu32 ": bank not started", out->pace);
+        return false;
+    }
+    while (esp_timer_get_time() - start < SELFTEST_MS * 1000LL) {
+        size_t n;
+        while ((n = capture_drain(batch, SELFTEST_BATCH)) > 0) {
+            int64_t now = esp_timer_get_time();
+            uint64_t batch_end = d.cycles;
+            for (size_t i = 0; i < n; i++) {
+                batch_end += batch[i].dt;
+            }
+            for (size_t i = 0; i < n; i++) {
+                fluke8050_reading_t r;
+                if (!fluke8050_decode(&d, &batch[i], &r)) {
+                    continue;
+                }
+                int64_t stamp = now - (batch_end - d.end_cycles) / cpu_mhz;
+                int64_t latency = esp_timer_get_time() - stamp;
+                if (out->scans + out->errors == 0 ||
+                    latency < out->latency_min_us) {
+                    out->latency_min_us = latency;
+                }
+                if (latency > out->latency_max_us) {
+                    out->latency_max_us = latency;
+                }
+                out->latency_total_us += latency;
+
+                if (same_reading(&r, &readings[expect])) {
+                    out->scans++;
+                } else {
+                    out->errors++;
+                    // Pick up again after whatever was lost.
+                    for (size_t k = 0; k < SELFTEST_READINGS; k++) {
+                        if (same_reading(&r, &readings[k])) {
+                            expect = k;
+                            break;
+                        }
+                    }
+                }
+                expect = (expect + 1) % SELFTEST_READINGS;
+            }
+        }
+        vTaskDelay(1);
+    }
+    if (!set_active_bank(0xFF)) {
+        ESP_LOGE(TAG, "pace %" PRIu32 ": bank not stopped", out->pace);
+        return false;
+    }
+    out->elapsed_us = esp_timer_get_time() - start;
+    out->pages = cpu1_counter - pages;
+
+    // Whatever the last scan left behind, so the next run starts clean.
+    vTaskDelay(1);
+    discard_capture();
+    capture_get_stats(&after);
+    out->torn = d.torn;
+    out->overflows = after.overflows - before.overflows;
+    return true;
+}
+
+static uint32_t per_second(uint32_t n, int64_t us) {
+    return us > 0 ? (uint64_t)n * 1000000ULL / us : 0;
+}
+
+static void log_run(const selftest_run_t *r) {
+    uint32_t decoded = r->scans + r->errors;
+    ESP_LOGI(TAG,
+             "pace %" PRIu32 ": %" PRIu32 " pages/s, %" PRIu32
+             " scans/s, %" PRIu32 " bad %" PRIu32 " torn %" PRIu32
+             " overflows, latency %" PRId64 "/%" PRId64 "/%" PRId64 " us",
+             r->pace, per_second(r->pages, r->elapsed_us),
+             per_second(r->scans, r->elapsed_us), r->errors, r->torn,
+             r->overflows, r->latency_min_us,
+             decoded ? r->latency_total_us / decoded : 0, r->latency_max_us);
+}
+
+static bool start(const fluke8050_selftest_config_t *cfg,
+                  fluke8050_decoder_t *fresh) {
+    if (!fluke8050_decoder_init(fresh, cfg->in.strobe_pins, cfg->in.data_pins,
+                                0)) {
+        ESP_LOGE(TAG, "bad in pin map");
+        return false;
+    }
+
+    // Input on the in pins; out pins that are also in pins become outputs
+    // too when the bank plays, and keep reading the pad.
+    uint64_t pins = 0;
+    for (int i = 0; i < FLUKE8050_STROBES; i++) {
+        pins |= 1ULL << cfg->in.strobe_pins[i];
+    }
+    for (int b = 0; b < 4; b++) {
+        pins |= 1ULL << cfg->in.data_pins[b];
+    }
+    gpio_config_t io = {.pin_bit_mask = pins,
+                        .mode = GPIO_MODE_INPUT,
+                        .pull_up_en = GPIO_PULLUP_DISABLE,
+                        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+                        .intr_type = GPIO_INTR_DISABLE};
+    if (gpio_config(&io) != ESP_OK) {
+        ESP_LOGE(TAG, "gpio_config failed");
+        return false;
+    }
+
+    make_readings();
+    size_t words =
+        fluke8050_replay_compile(readings, SELFTEST_READINGS, &cfg->out,
+                                 SELFTEST_STROBE_PAGES, prog,
+                                 sizeof(prog) / sizeof(prog[0]));
+    if (words == 0 || !init_gpios_rle(2, words, PATTERN_MEM_DRAM) ||
+        !write_rle_bank(0, prog, words)) {
+        ESP_LOGE(TAG, "replay setup failed");
+        return false;
+    }
+
+    capture_config_t capture = {.samples = cfg->samples};
+    fluke8050_decoder_capture(fresh, &capture);
+    if (!capture_start(&capture)) {
+        ESP_LOGE(TAG, "capture_start failed");
+        deinit_gpios();
+        return false;
+    }
+    return true;
+}
+
+bool fluke8050_selftest(const fluke8050_selftest_config_t *cfg) {
+    fluke8050_decoder_t fresh;
+    if (!start(cfg, &fresh)) {
+        return false;
+    }
+    uint32_t cpu_mhz = esp_clk_cpu_freq() / 1000000;
+    ESP_LOGI(TAG, "%u readings, %u pages each", SELFTEST_READINGS,
+             FLUKE8050_REPLAY_PAGES(1, SELFTEST_STROBE_PAGES));
+
+    selftest_run_t best = {0};
+    uint64_t fit = (uint64_t)SELFTEST_MS * 1000 * cpu_mhz /
+                   (SELFTEST_MIN_CYCLES * SELFTEST_CYCLE_PAGES);
+    uint32_t pace = fit < SELFTEST_SLOWEST_PACE ? fit : SELFTEST_SLOWEST_PACE;
+    bool ok = true;
+    while (true) {
+        selftest_run_t r = {.pace = pace};
+        if (!set_pacing(pace)) {
+            ESP_LOGE(TAG, "pace %" PRIu32 " not taken", pace);
+            ok = false;
+            break;
+        }
+        if (!run(&fresh, cpu_mhz, &r)) {
+            ok = false;
+            break;
+        }
+        log_run(&r);
+        if (r.scans != 0 && r.errors == 0 && r.torn == 0 &&
+            r.overflows == 0 && r.scans > best.scans) {
+            best = r;
+        }
+        if (pace == 0) {
+            break;
+        }
+        pace = pace / 2 < SELFTEST_FASTEST_PACE ? 0 : pace / 2;
+    }
+
+    // Each of these waits out a whole cycle at the last pace if need be.
+    if (!capture_stop() || !set_pacing(0) || !deinit_gpios()) {
+        ESP_LOGE(TAG, "sequencer not released");
+        ok = false;
+    }
+
+    if (!ok) {
+        return false;
+    }
+    if (best.scans == 0) {
+        ESP_LOGE(TAG, "no clean run, check the jumpers");
+        return false;
+    }
+    ESP_LOGI(TAG, "fastest clean run:");
+    log_run(&best);
+    return true;
+}
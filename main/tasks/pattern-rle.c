@@ -0,0 +1,188 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pattern-rle.h"
+
+// Longest block the encoder looks for repeats of.
+#define RLE_MAX_BLOCK 32
+
+static inline bool same_page(const uint32_t *pages, size_t a, size_t b) {
+    return pages[a * 2] == pages[b * 2] && pages[a * 2 + 1] == pages[b * 2 + 1];
+}
+
+static bool same_block(const uint32_t *pages, size_t a, size_t b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (!same_page(pages, a + i, b + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t run_length(const uint32_t *pages, size_t start, size_t end) {
+    size_t run = 1;
+    while (start + run < end && run < RLE_COUNT_MASK &&
+           same_page(pages, start, start + run)) {
+        run++;
+    }
+    return run;
+}
+
+// Words to encode [start, end) as plain runs.
+static size_t runs_cost(const uint32_t *pages, size_t start, size_t end) {
+    size_t words = 0;
+    while (start < end) {
+        start += run_length(pages, start, end);
+        words += 3;
+    }
+    return words;
+}
+
+static bool emit_runs(const uint32_t *pages, size_t start, size_t end,
+                      uint32_t *out, size_t *pos, size_t max_words) {
+    while (start < end) {
+        size_t run = run_length(pages, start, end);
+        if (*pos + 3 > max_words) {
+            return false;
+        }
+        out[(*pos)++] = RLE_WORD(RLE_OP_PAGE, run);
+        out[(*pos)++] = pages[start * 2];
+        out[(*pos)++] = pages[start * 2 + 1];
+        start += run;
+    }
+    return true;
+}
+
+// Greedy: at each position take whichever of a plain run or a repeated
+// block covers the most pages per word.
+size_t rle_encode(const uint32_t *pages, size_t count, uint32_t *out,
+                  size_t max_words) {
+    size_t pos = 0;
+    size_t i = 0;
+    while (i < count) {
+        size_t best_cover = run_length(pages, i, count);
+        size_t best_cost = 3;
+        size_t best_block = 0;
+        size_t best_reps = 0;
+
+        for (size_t len = 2; len <= RLE_MAX_BLOCK && i + 2 * len <= count;
+             len++) {
+            size_t reps = 1;
+            while (i + (reps + 1) * len <= count && reps < RLE_COUNT_MASK &&
+                   same_block(pages, i, i + reps * len, len)) {
+                reps++;
+            }
+            if (reps < 2) {
+                continue;
+            }
+            size_t cost = 2 + runs_cost(pages, i, i + len);
+            if (reps * len * best_cost > best_cover * cost) {
+                best_cover = reps * len;
+                best_cost = cost;
+                best_block = len;
+                best_reps = reps;
+            }
+        }
+
+        if (best_block == 0) {
+            if (!emit_runs(pages, i, i + best_cover, out, &pos, max_words)) {
+                return 0;
+            }
+        } else {
+            if (pos + 1 > max_words) {
+                return 0;
+            }
+            out[pos++] = RLE_WORD(RLE_OP_LOOP, best_reps);
+            if (!emit_runs(pages, i, i + best_block, out, &pos, max_words)) {
+                return 0;
+            }
+            if (pos + 1 > max_words) {
+                return 0;
+            }
+            out[pos++] = RLE_WORD(RLE_OP_END, 0);
+        }
+        i += best_cover;
+    }
+
+    if (pos + 1 > max_words) {
+        return 0;
+    }
+    out[pos++] = RLE_WORD(RLE_OP_EOP, 0);
+    return pos;
+}
+
+bool rle_validate(const uint32_t *prog, size_t words) {
+    int depth = 0;
+    bool emits = false;
+    for (size_t pc = 0; pc < words;) {
+        uint32_t op = RLE_GET_OP(prog[pc]);
+        uint32_t n = RLE_GET_COUNT(prog[pc]);
+        if (op == RLE_OP_PAGE) {
+            if (n == 0 || pc + 3 > words) {
+                return false;
+            }
+            emits = true;
+            pc += 3;
+        } else if (op == RLE_OP_LOOP) {
+            if (n == 0 || ++depth > RLE_MAX_DEPTH) {
+                return false;
+            }
+            pc++;
+        } else if (op == RLE_OP_END) {
+            if (--depth < 0) {
+                return false;
+            }
+            pc++;
+        } else if (op == RLE_OP_EOP) {
+            // A program with no pages would spin the APP cpu without ever
+            // reaching a cycle boundary worth the name.
+            return depth == 0 && emits;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+uint64_t rle_decoded_length(const uint32_t *prog, size_t words) {
+    uint64_t total[RLE_MAX_DEPTH + 1] = {0};
+    uint32_t reps[RLE_MAX_DEPTH + 1] = {0};
+    int depth = 0;
+    for (size_t pc = 0; pc < words;) {
+        uint32_t op = RLE_GET_OP(prog[pc]);
+        uint32_t n = RLE_GET_COUNT(prog[pc]);
+        if (op == RLE_OP_PAGE) {
+            total[depth] += n;
+            pc += 3;
+        } else if (op == RLE_OP_LOOP && depth < RLE_MAX_DEPTH) {
+            depth++;
+            total[depth] = 0;
+            reps[depth] = n;
+            pc++;
+        } else if (op == RLE_OP_END && depth > 0) {
+            uint64_t body = total[depth];
+            uint64_t sum = body * reps[depth];
+            if (reps[depth] != 0 && sum / reps[depth] != body) {
+                return UINT64_MAX;
+            }
+            depth--;
+            total[depth] += sum;
+            pc++;
+        } else {
+            break;
+        }
+    }
+    return total[0];
+}
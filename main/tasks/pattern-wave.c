@@ -0,0 +1,228 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pattern-wave.h"
+
+#define WAVE_MAX_PINS 32
+
+// A pin's waveform in CPU cycles.
+typedef struct wave_timing {
+    const wave_pin_t *desc;
+    uint64_t period;
+    uint64_t high;   // WAVE_CLOCK
+    uint64_t bit;    // WAVE_BITS
+    uint64_t phase;  // Delay into the period
+} wave_timing_t;
+
+typedef struct wave_plan {
+    wave_timing_t pin[WAVE_MAX_PINS];
+    size_t count;
+    uint64_t period;  // Least common multiple of the pins' periods
+    uint64_t step;    // Greatest common divisor of every edge time
+    uint32_t gpios;
+} wave_plan_t;
+
+static uint64_t gcd(uint64_t a, uint64_t b) {
+    while (b != 0) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static uint64_t div_round(uint64_t n, uint64_t d) { return (n + d / 2) / d; }
+
+static bool bit_at(const wave_pin_t *p, uint32_t i) {
+    return (p->bits[i / 8] >> (i % 8)) & 1;
+}
+
+// Fills in t and returns the divisor of all the pin's edge times.
+static wave_status_t time_pin(const wave_pin_t *p, uint32_t cpu_hz,
+                              wave_timing_t *t, uint64_t *step) {
+    if (p->pin > 31 || p->hz == 0 || p->hz > cpu_hz) {
+        return WAVE_EINVAL;
+    }
+    t->desc = p;
+    if (p->kind == WAVE_CLOCK) {
+        if (p->duty > 100) {
+            return WAVE_EINVAL;
+        }
+        t->period = div_round(cpu_hz, p->hz);
+        t->high = div_round(t->period * p->duty, 100);
+        *step = gcd(t->period, t->high);
+    } else if (p->kind == WAVE_BITS) {
+        if (p->bits == NULL || p->nbits == 0) {
+            return WAVE_EINVAL;
+        }
+        t->bit = div_round(cpu_hz, p->hz);
+        t->period = t->bit * p->nbits;
+        // Only bit boundaries where the level changes are edges.
+        *step = t->period;
+        for (uint32_t i = 1; i < p->nbits; i++) {
+            if (bit_at(p, i) != bit_at(p, i - 1)) {
+                *step = gcd(*step, i * t->bit);
+            }
+        }
+    } else {
+        return WAVE_EINVAL;
+    }
+    if (t->period > UINT32_MAX) {
+        return WAVE_ETOOLONG;
+    }
+    t->phase = div_round(t->period * (p->phase % 360), 360) % t->period;
+    *step = gcd(*step, t->phase);
+    return WAVE_OK;
+}
+
+static wave_status_t plan(const wave_pin_t *pins, size_t count,
+                          uint32_t cpu_hz, wave_plan_t *w) {
+    if (count == 0 || count > WAVE_MAX_PINS) {
+        return WAVE_EINVAL;
+    }
+    w->count = count;
+    w->period = 1;
+    w->step = 0;
+    w->gpios = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t step;
+        wave_status_t err = time_pin(&pins[i], cpu_hz, &w->pin[i], &step);
+        if (err != WAVE_OK) {
+            return err;
+        }
+        uint64_t p = w->pin[i].period;
+        w->period = w->period / gcd(w->period, p) * p;
+        if (w->period > UINT32_MAX) {
+            return WAVE_ETOOLONG;
+        }
+        w->step = gcd(w->step, step);
+        w->gpios |= 1UL << pins[i].pin;
+    }
+    return WAVE_OK;
+}
+
+// Cycles into the pin's period at time now.
+static uint64_t offset(const wave_timing_t *t, uint64_t now) {
+    return (now % t->period + t->period - t->phase) % t->period;
+}
+
+static uint32_t state_at(const wave_plan_t *w, uint64_t now) {
+    uint32_t state = 0;
+    for (size_t i = 0; i < w->count; i++) {
+        const wave_timing_t *t = &w->pin[i];
+        uint64_t u = offset(t, now);
+        bool high = t->desc->kind == WAVE_CLOCK ? u < t->high
+                                                : bit_at(t->desc, u / t->bit);
+        if (high) {
+            state |= 1UL << t->desc->pin;
+        }
+    }
+    return state;
+}
+
+// First time after now that any pin may change.
+static uint64_t next_edge(const wave_plan_t *w, uint64_t now) {
+    uint64_t next = w->period;
+    for (size_t i = 0; i < w->count; i++) {
+        const wave_timing_t *t = &w->pin[i];
+        uint64_t u = offset(t, now);
+        uint64_t wait;
+        if (t->desc->kind == WAVE_CLOCK) {
+            wait = u < t->high ? t->high - u : t->period - u;
+        } else {
+            wait = t->bit - u % t->bit;
+        }
+        if (now + wait < next) {
+            next = now + wait;
+        }
+    }
+    return next;
+}
+
+static void set_program(const wave_plan_t *w, uint32_t pages,
+                        wave_program_t *out) {
+    out->period_cycles = w->period;
+    out->step_cycles = w->step;
+    out->pages = pages;
+    out->gpios = w->gpios;
+}
+
+wave_status_t wave_compile_flat(const wave_pin_t *pins, size_t count,
+                                uint32_t cpu_hz, uint32_t *set,
+                                uint32_t *clear, size_t max_pages,
+                                wave_program_t *out) {
+    wave_plan_t w;
+    wave_status_t err = plan(pins, count, cpu_hz, &w);
+    if (err != WAVE_OK) {
+        return err;
+    }
+    uint64_t steps = w.period / w.step;
+    if (steps > max_pages) {
+        return WAVE_ENOSPC;
+    }
+    for (uint64_t i = 0; i < steps; i++) {
+        uint32_t state = state_at(&w, i * w.step);
+        set[i] = state;
+        clear[i] = ~state & w.gpios;
+    }
+    set_program(&w, steps, out);
+    return WAVE_OK;
+}
+
+wave_status_t wave_compile_timed(const wave_pin_t *pins, size_t count,
+                                 uint32_t cpu_hz, timed_page_t *pages,
+                                 size_t max_pages, wave_program_t *out) {
+    wave_plan_t w;
+    wave_status_t err = plan(pins, count, cpu_hz, &w);
+    if (err != WAVE_OK) {
+        return err;
+    }
+    size_t n = 0;
+    uint64_t now = 0;
+    while (now < w.period) {
+        uint32_t state = state_at(&w, now);
+        uint64_t end = next_edge(&w, now);
+        // Edges where nothing changes, such as a bit boundary between equal
+        // bits, stay in the same page.
+        while (end < w.period && state_at(&w, end) == state) {
+            end = next_edge(&w, end);
+        }
+        if (n == max_pages) {
+            return WAVE_ENOSPC;
+        }
+        if (end - now < TIMED_PAGE_MIN_CYCLES) {
+            return WAVE_ETOOSHORT;
+        }
+        pages[n].set = state;
+        pages[n].clear = ~state & w.gpios;
+        pages[n].cycles = end - now;
+        pages[n].reserved = 0;
+        n++;
+        now = end;
+    }
+    set_program(&w, n, out);
+    return WAVE_OK;
+}
+
+static const char *const errors[] = {
+    "ok", "invalid pin description", "common period too long",
+    "too many pages", "timed page too short"};
+
+const char *wave_strerror(wave_status_t status) {
+    if (status >= sizeof(errors) / sizeof(errors[0])) {
+        return "unknown";
+    }
+    return errors[status];
+}
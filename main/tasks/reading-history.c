@@ -0,0 +1,128 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "reading-history.h"
+
+#include "string.h"
+
+void history_init(reading_history_t *h, history_sample_t *samples,
+                  uint32_t capacity) {
+    h->samples = samples;
+    h->capacity = capacity;
+    history_reset(h);
+}
+
+void history_reset(reading_history_t *h) {
+    h->total = 0;
+    memset(&h->stats, 0, sizeof(h->stats));
+    h->stats.min = INT32_MAX;
+    h->stats.max = INT32_MIN;
+}
+
+void history_push(reading_history_t *h, uint32_t time_ms, int32_t value) {
+    history_sample_t *s = &h->samples[h->total % h->capacity];
+    s->time_ms = time_ms;
+    s->value = value;
+    h->total++;
+
+    history_stats_t *st = &h->stats;
+    if (st->count == 0) {
+        st->first_ms = time_ms;
+        st->base = value;
+    }
+    st->last_ms = time_ms;
+    st->count++;
+    if (value < st->min) {
+        st->min = value;
+    }
+    if (value > st->max) {
+        st->max = value;
+    }
+    int64_t delta = (int64_t)value - st->base;
+    uint64_t sq = (uint64_t)(delta * delta);
+    st->sum += delta;
+    st->sum2 = st->sum2 > UINT64_MAX - sq ? UINT64_MAX : st->sum2 + sq;
+}
+
+uint32_t history_first(const reading_history_t *h) {
+    return h->total > h->capacity ? h->total - h->capacity : 0;
+}
+
+size_t history_copy(const reading_history_t *h, uint32_t from,
+                    history_sample_t *out, size_t max, uint32_t *next) {
+    uint32_t first = history_first(h);
+    if (from < first) {
+        from = first;
+    }
+    size_t n = 0;
+    while (n < max && from < h->total) {
+        out[n++] = h->samples[from % h->capacity];
+        from++;
+    }
+    *next = from;
+    return n;
+}
+
+int32_t history_mean(const history_stats_t *stats) {
+    if (stats->count == 0) {
+        return 0;
+    }
+    int64_t n = stats->count;
+    int64_t q = stats->sum / n;
+    int64_t r = stats->sum % n;
+    if (2 * r >= n) {
+        q++;
+    } else if (2 * r <= -n) {
+        q--;
+    }
+    return stats->base + q;
+}
+
+static uint32_t isqrt64(uint64_t v) {
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+int32_t history_stddev(const history_stats_t *stats) {
+    if (stats->count < 2) {
+        return 0;
+    }
+    if (stats->sum2 == UINT64_MAX) {
+        return -1;
+    }
+    // sum2 - sum^2 / n without squaring sum: with sum = q * n + r, that is
+    // n q^2 + 2 q r + r^2 / n, every term of which fits since they add up to
+    // no more than sum2. q and r share a sign.
+    uint64_t n = stats->count;
+    int64_t sum = stats->sum;
+    uint64_t mag = sum < 0 ? -(uint64_t)sum : (uint64_t)sum;
+    uint64_t q = mag / n;
+    uint64_t r = mag % n;
+    uint64_t sq = n * q * q + 2 * q * r + r * r / n;
+    return isqrt64((stats->sum2 - sq) / (n - 1));
+}
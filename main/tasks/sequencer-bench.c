@@ -0,0 +1,163 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sequencer-bench.h"
+
+#include "esp32-cpu1.h"
+#include "esp32/clk.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "pattern-rle.h"
+#include "xtensa/core-macros.h"
+
+#define BENCH_GPIO1 (1 << 25)
+#define BENCH_GPIO2 (1 << 26)
+#define BENCH_PAGES 240
+#define BENCH_LONG_LOOPS 100
+#define BENCH_MS 200
+#define BENCH_SWAPS 200
+
+static const char *TAG = "seq-bench";
+
+static gpio_page_t flat[BENCH_PAGES];
+static uint32_t prog[BENCH_PAGES * 3 + 3];
+
+// run is how many times each page repeats. With 1 the encoder can only loop
+// over page pairs, which is the most decode work per page.
+static void make_pattern(size_t count, size_t run) {
+    for (size_t i = 0; i < count; i++) {
+        size_t step = i / run;
+        flat[i].set = (step & 1) ? BENCH_GPIO1 : BENCH_GPIO2;
+        flat[i].clear = (step & 1) ? BENCH_GPIO2 : BENCH_GPIO1;
+    }
+}
+
+static uint32_t measure() {
+    uint32_t start = cpu1_counter;
+    int64_t t0 = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(BENCH_MS));
+    uint32_t pages = cpu1_counter - start;
+    int64_t t1 = esp_timer_get_time();
+    return (uint64_t)pages * 1000000ULL / (t1 - t0);
+}
+
+static void bench_flat(const char *name, size_t count) {
+    uint32_t set[BENCH_PAGES];
+    uint32_t clear[BENCH_PAGES];
+    for (size_t i = 0; i < count; i++) {
+        set[i] = flat[i].set;
+        clear[i] = flat[i].clear;
+    }
+    if (!init_gpios(2, count) || !write_set_bank(0, 0, count, set) ||
+        !write_clear_bank(0, 0, count, clear) || !set_active_bank(0)) {
+        ESP_LOGE(TAG, "%s: flat setup failed", name);
+        return;
+    }
+    uint32_t rate = measure();
+    ESP_LOGI(TAG, "%s flat: %u pages, %u bytes, %u pages/s", name,
+             (unsigned)count, (unsigned)(count * sizeof(gpio_page_t)),
+             (unsigned)rate);
+    set_active_bank(0xFF);
+}
+
+// loops > 1 wraps the encoded pattern in an outer RLE_OP_LOOP.
+static void bench_rle(const char *name, size_t count, uint32_t loops) {
+    size_t words = rle_encode((const uint32_t *)flat, count, prog + 1,
+                              sizeof(prog) / sizeof(prog[0]) - 2);
+    if (words != 0) {
+        prog[0] = RLE_WORD(RLE_OP_LOOP, loops);
+        prog[words] = RLE_WORD(RLE_OP_END, 0);
+        prog[words + 1] = RLE_WORD(RLE_OP_EOP, 0);
+        words += 2;
+    }
+    if (words == 0 ||
+        !init_gpios_rle(2, words, PATTERN_MEM_DRAM) ||
+        !write_rle_bank(0, prog, words) || !set_active_bank(0)) {
+        ESP_LOGE(TAG, "%s: rle setup failed", name);
+        return;
+    }
+    uint32_t rate = measure();
+    ESP_LOGI(TAG, "%s rle: %u pages, %u bytes, %u pages/s", name,
+             (unsigned)rle_decoded_length(prog, words),
+             (unsigned)(words * sizeof(uint32_t)), (unsigned)rate);
+    set_active_bank(0xFF);
+}
+
+// Request to applied, timed here, and request to ack as the FROM_CPU_INTR2
+// handler records it. Swaps land at the end of a page cycle, so this is
+// mostly how long the rest of the cycle takes.
+static void bench_swaps(size_t count) {
+    uint32_t set[BENCH_PAGES];
+    uint32_t clear[BENCH_PAGES];
+    for (size_t i = 0; i < count; i++) {
+        set[i] = flat[i].set;
+        clear[i] = flat[i].clear;
+    }
+    if (!init_gpios(2, count) || !write_set_bank(0, 0, count, set) ||
+        !write_clear_bank(0, 0, count, clear) ||
+        !write_set_bank(1, 0, count, clear) ||
+        !write_clear_bank(1, 0, count, set) || !set_active_bank(0)) {
+        ESP_LOGE(TAG, "swap: setup failed");
+        return;
+    }
+
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t total = 0;
+    for (int i = 0; i < BENCH_SWAPS; i++) {
+        uint32_t start = XTHAL_GET_CCOUNT();
+        uint32_t seq = request_bank((i & 1) ? 0 : 1, NULL, NULL);
+        if (seq == 0 || !cpu1_wait(seq, cpu1_cycle_wait_us())) {
+            ESP_LOGE(TAG, "swap: %d timed out", i);
+            set_active_bank(0xFF);
+            return;
+        }
+        uint32_t cycles = XTHAL_GET_CCOUNT() - start;
+        min = cycles < min ? cycles : min;
+        max = cycles > max ? cycles : max;
+        total += cycles;
+    }
+    uint32_t ack_max;
+    get_bank_switch_latency(NULL, &ack_max);
+    uint32_t cycles_per_us = esp_clk_cpu_freq() / 1000000;
+    ESP_LOGI(TAG,
+             "swap: %u pages, %d swaps, %u/%u/%u us min/avg/max applied, "
+             "%u us worst ack",
+             (unsigned)count, BENCH_SWAPS, (unsigned)(min / cycles_per_us),
+             (unsigned)(total / BENCH_SWAPS / cycles_per_us),
+             (unsigned)(max / cycles_per_us),
+             (unsigned)(ack_max / cycles_per_us));
+    set_active_bank(0xFF);
+}
+
+void sequencer_benchmark() {
+    make_pattern(BENCH_PAGES, 1);
+    bench_flat("toggle", BENCH_PAGES);
+    bench_rle("toggle", BENCH_PAGES, 1);
+
+    make_pattern(BENCH_PAGES, 8);
+    bench_flat("runs of 8", BENCH_PAGES);
+    bench_rle("runs of 8", BENCH_PAGES, 1);
+
+    // Far past what a flat bank can hold.
+    bench_rle("runs of 8 looped", BENCH_PAGES, BENCH_LONG_LOOPS);
+
+    bench_swaps(BENCH_PAGES);
+    bench_swaps(8);
+
+    deinit_gpios();
+}
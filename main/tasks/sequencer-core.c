@@ -0,0 +1,503 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sequencer-core.h"
+
+volatile DRAM_ATTR uint32_t cpu1_counter = 0;
+
+volatile DRAM_ATTR void *volatile arena = NULL;
+volatile DRAM_ATTR pattern_format_t pattern_format = PATTERN_FLAT;
+volatile DRAM_ATTR uint8_t page_size = sizeof(gpio_page_t);
+volatile DRAM_ATTR uint8_t banks = 0;
+volatile DRAM_ATTR uint8_t pages = 0;
+volatile DRAM_ATTR uint16_t bank_words = 0;
+volatile DRAM_ATTR uint8_t active_bank = 0xFF;
+
+DRAM_ATTR mailbox_t mailbox = {0};
+
+// State owned by the APP cpu, only changed by commands from the mailbox.
+typedef struct app_cpu_state {
+    uint8_t bank;
+    uint32_t pace_cycles;
+} app_cpu_state_t;
+
+volatile DRAM_ATTR uint32_t timed_worst_jitter = 0;
+volatile DRAM_ATTR uint32_t timed_late_pages = 0;
+
+DRAM_ATTR capture_ring_t capture = {0};
+volatile DRAM_ATTR bool capture_enabled = false;
+
+DRAM_ATTR page_stats_t page_stats = {.min = UINT32_MAX};
+
+volatile DRAM_ATTR bool app_cpu_parked = false;
+volatile DRAM_ATTR uint32_t app_cpu_wakeups = 0;
+
+uint32_t patch_gpios(uint8_t len, uint8_t fields, const uint32_t *src,
+                     uint8_t stride) {
+    uint32_t mask = 0;
+    uint8_t words = ((fields & PATCH_SET) != 0) + ((fields & PATCH_CLEAR) != 0);
+    for (uint8_t i = 0; i < len; i++) {
+        for (uint8_t w = 0; w < words; w++) {
+            mask |= src[i * stride + w];
+        }
+    }
+    return mask;
+}
+
+uint32_t bank_gpios(uint8_t bank) {
+    uint32_t mask = 0;
+    if (bank == 0xFF) {
+        return 0;
+    }
+    if (pattern_format == PATTERN_RLE) {
+        volatile uint32_t *prog = prog_at(bank);
+        for (uint32_t pc = 0; pc < bank_words;) {
+            uint32_t op = RLE_GET_OP(prog[pc]);
+            if (op == RLE_OP_PAGE && pc + 3 <= bank_words) {
+                mask |= prog[pc + 1];
+                mask |= prog[pc + 2];
+                pc += 3;
+            } else if (op == RLE_OP_LOOP || op == RLE_OP_END) {
+                pc++;
+            } else {
+                break;
+            }
+        }
+        return mask;
+    }
+    for (int i = 0; i < pages; i++) {
+        volatile gpio_page_t *page = page_at(bank, i);
+        mask |= page->set;
+        mask |= page->clear;
+    }
+    return mask;
+}
+
+uint64_t bank_cycle_cycles(uint8_t bank, uint32_t pace_cycles) {
+    if (bank == 0xFF || bank >= banks) {
+        return 0;
+    }
+    if (pattern_format == PATTERN_TIMED) {
+        uint64_t total = 0;
+        for (int i = 0; i < pages; i++) {
+            total += ((volatile timed_page_t *)page_at(bank, i))->cycles;
+        }
+        return total;
+    }
+
+    uint64_t per_page = pace_cycles;
+    if (per_page < FREE_PAGE_CYCLES) {
+        per_page = FREE_PAGE_CYCLES;
+    }
+    uint64_t count = pages;
+    if (pattern_format == PATTERN_RLE) {
+        // A playing program is never rewritten, see write_rle_bank().
+        count = rle_decoded_length((const uint32_t *)prog_at(bank),
+                                   bank_words);
+    }
+    if (count > UINT64_MAX / per_page) {
+        return UINT64_MAX;
+    }
+    return count * per_page;
+}
+
+bool check_cmd(const cpu1_cmd_t *cmd) {
+    if (cmd->op == CPU1_SWAP_BANK) {
+        ERR_ON(cmd->bank >= banks && cmd->bank != 0xFF, return false);
+    } else if (cmd->op == CPU1_PATCH_PAGES) {
+        ERR_ON(pattern_format == PATTERN_RLE, return false);
+        ERR_ON(cmd->bank >= banks, return false);
+        ERR_ON(cmd->len == 0, return false);
+        ERR_ON(cmd->offset + cmd->len > pages, return false);
+        ERR_ON(cmd->src == NULL, return false);
+        ERR_ON(cmd->fields == 0 || cmd->fields & ~PATCH_TIMED_PAGE,
+               return false);
+        ERR_ON(pattern_format != PATTERN_TIMED && (cmd->fields & PATCH_CYCLES),
+               return false);
+        if (cmd->fields & PATCH_CYCLES) {
+            uint8_t stride = field_count(cmd->fields);
+            uint8_t at = stride - 1;
+            for (uint8_t i = 0; i < cmd->len; i++) {
+                ERR_ON(cmd->src[i * stride + at] < TIMED_PAGE_MIN_CYCLES,
+                       return false);
+            }
+        }
+    } else if (cmd->op == CPU1_CAPTURE_START) {
+        ERR_ON(capture.buf == NULL, return false);
+    } else if (cmd->op == CPU1_READ_STATS) {
+        ERR_ON(cmd->stats == NULL, return false);
+    } else {
+        ERR_ON(cmd->op != CPU1_SET_PACING && cmd->op != CPU1_CAPTURE_STOP &&
+                   cmd->op != CPU1_RESET_STATS,
+               return false);
+    }
+    return true;
+}
+
+static inline void IRAM_ATTR begin_capture() {
+    uint32_t now = seq_ccount();
+    capture.next_ccount = now;
+    capture.last_ccount = now;
+    seq_in(&capture.last_in, &capture.last_in1);
+    capture_enabled = true;
+}
+
+// Everything the APP cpu runs has to be in IRAM, and it must not use switch
+// statements: their jump tables land in flash, which this core cannot read.
+static cpu1_status_t IRAM_ATTR apply_cmd(app_cpu_state_t *st,
+                                         volatile cpu1_cmd_t *cmd) {
+    cpu1_op_t op = cmd->op;
+    if (op == CPU1_SWAP_BANK) {
+        if (cmd->bank >= banks && cmd->bank != 0xFF) {
+            return CPU1_EINVAL;
+        }
+        if (cmd->bank != st->bank) {
+            page_stats.bank_switches++;
+        }
+        st->bank = cmd->bank;
+        active_bank = st->bank;
+    } else if (op == CPU1_PATCH_PAGES) {
+        if (cmd->bank >= banks || cmd->offset + cmd->len > pages) {
+            return CPU1_EINVAL;
+        }
+        const uint32_t *src = cmd->src;
+        uint8_t fields = cmd->fields;
+        for (uint8_t i = 0; i < cmd->len; i++) {
+            volatile uint32_t *dst =
+                (volatile uint32_t *)page_at(cmd->bank, cmd->offset + i);
+            if (fields & PATCH_SET) {
+                dst[0] = *src++;
+            }
+            if (fields & PATCH_CLEAR) {
+                dst[1] = *src++;
+            }
+            if (fields & PATCH_CYCLES) {
+                dst[2] = *src++;
+            }
+        }
+    } else if (op == CPU1_SET_PACING) {
+        st->pace_cycles = cmd->pace_cycles;
+    } else if (op == CPU1_CAPTURE_START) {
+        begin_capture();
+    } else if (op == CPU1_CAPTURE_STOP) {
+        capture_enabled = false;
+    } else if (op == CPU1_READ_STATS) {
+        cpu1_stats_t *stats = cmd->stats;
+        stats->pages = cpu1_counter;
+        stats->active_bank = st->bank;
+        stats->pace_cycles = st->pace_cycles;
+        stats->timed_worst_jitter = timed_worst_jitter;
+        stats->timed_late_pages = timed_late_pages;
+        stats->capture_samples = capture.samples;
+        stats->capture_overflows = capture.overflows;
+        stats->wakeups = app_cpu_wakeups;
+        for (int i = 0; i < CPU1_HIST_BUCKETS; i++) {
+            stats->period_hist[i] = page_stats.hist[i];
+        }
+        stats->period_min = page_stats.periods ? page_stats.min : 0;
+        stats->period_max = page_stats.max;
+        stats->period_total = page_stats.total;
+        stats->periods = page_stats.periods;
+        stats->stalls = page_stats.stalls;
+        stats->bank_switches = page_stats.bank_switches;
+    } else if (op == CPU1_RESET_STATS) {
+        timed_worst_jitter = 0;
+        timed_late_pages = 0;
+        for (int i = 0; i < CPU1_HIST_BUCKETS; i++) {
+            page_stats.hist[i] = 0;
+        }
+        page_stats.min = UINT32_MAX;
+        page_stats.max = 0;
+        page_stats.total = 0;
+        page_stats.periods = 0;
+        page_stats.stalls = 0;
+        page_stats.bank_switches = 0;
+    } else {
+        return CPU1_EINVAL;
+    }
+    return CPU1_OK;
+}
+
+// Applies every queued command, called only between page cycles.
+static void IRAM_ATTR poll_mailbox(app_cpu_state_t *st) {
+    uint32_t tail = mailbox.cmd_tail;
+    uint32_t head = mailbox.cmd_head;
+    if (tail == head) {
+        return;
+    }
+    seq_memw();
+    while (tail != head) {
+        mailbox.status[SLOT(tail)] = apply_cmd(st, &mailbox.cmd[SLOT(tail)]);
+        tail++;
+    }
+    seq_memw();
+    mailbox.cmd_tail = tail;
+    seq_notify();
+}
+
+static inline void IRAM_ATTR poll_capture() {
+    if (!capture_enabled) {
+        return;
+    }
+
+    uint32_t now = seq_ccount();
+    uint32_t in, in1;
+    seq_in(&in, &in1);
+
+    if (capture.cfg.mode == CAPTURE_PERIODIC) {
+        if ((int32_t)(now - capture.next_ccount) < 0) {
+            return;
+        }
+        capture.next_ccount += capture.cfg.period_cycles;
+        if ((int32_t)(now - capture.next_ccount) >= 0) {
+            // Fell a whole period behind, resync instead of bursting.
+            capture.next_ccount = now + capture.cfg.period_cycles;
+        }
+    } else {
+        uint32_t changed = ((in ^ capture.last_in) & capture.cfg.trig_mask) |
+                           ((in1 ^ capture.last_in1) & capture.cfg.trig1_mask);
+        capture.last_in = in;
+        capture.last_in1 = in1;
+        if (!changed) {
+            return;
+        }
+    }
+
+    uint32_t dt = now - capture.last_ccount;
+    capture.last_ccount = now;
+    capture.samples++;
+
+    uint32_t head = capture.head;
+    if (head - capture.tail > capture.mask) {
+        capture.overflows++;
+        return;
+    }
+    volatile capture_sample_t *sample = &capture.buf[head & capture.mask];
+    sample->in = in & capture.cfg.in_mask;
+    sample->in1 = in1 & capture.cfg.in1_mask;
+    sample->dt = dt > 0xFFFF ? 0xFFFF : dt;
+    seq_memw();
+    capture.head = head + 1;
+}
+
+// Called right after each page write with the period the page was meant to
+// have, 0 when running free. A handful of cycles: one CCOUNT read, an NSAU
+// and a few adds.
+static inline void IRAM_ATTR record_page(uint32_t now, uint32_t expected) {
+    uint32_t period = now - page_stats.last;
+    page_stats.last = now;
+
+    int bucket = 31 - __builtin_clz(period | 1) - CPU1_HIST_SHIFT;
+    if (bucket < 0) {
+        bucket = 0;
+    } else if (bucket >= CPU1_HIST_BUCKETS) {
+        bucket = CPU1_HIST_BUCKETS - 1;
+    }
+    page_stats.hist[bucket]++;
+
+    if (period < page_stats.min) {
+        page_stats.min = period;
+    }
+    if (period > page_stats.max) {
+        page_stats.max = period;
+    }
+    page_stats.total += period;
+    page_stats.periods++;
+
+    if (expected == 0) {
+        expected = page_stats.min;
+    }
+    if (period >= 2 * expected) {
+        page_stats.stalls++;
+    }
+}
+
+static void IRAM_ATTR park_app_cpu() {
+    app_cpu_parked = true;
+    seq_memw();
+    if (mailbox.cmd_head != mailbox.cmd_tail || capture_enabled) {
+        app_cpu_parked = false;
+        return;
+    }
+
+    seq_halt();
+
+    app_cpu_parked = false;
+    app_cpu_wakeups++;
+    seq_memw();
+    seq_notify();
+}
+
+static void IRAM_ATTR run_untimed(app_cpu_state_t *st) {
+    uint32_t deadline = seq_ccount();
+    while (st->bank != 0xFF && pattern_format == PATTERN_FLAT) {
+        const volatile gpio_page_t *page =
+            (const volatile gpio_page_t *)arena + st->bank * pages;
+        const volatile gpio_page_t *end = page + pages;
+        uint32_t pace = st->pace_cycles;
+        if (pace == 0) {
+            while (page != end) {
+                seq_out(page->set, page->clear);
+                record_page(seq_ccount(), 0);
+                page++;
+                cpu1_counter++;
+                poll_capture();
+            }
+        } else {
+            while (page != end) {
+                while ((int32_t)(seq_ccount() - deadline) < 0) {
+                    poll_capture();
+                }
+                seq_out(page->set, page->clear);
+                record_page(seq_ccount(), pace);
+                deadline += pace;
+                page++;
+                cpu1_counter++;
+            }
+        }
+        poll_mailbox(st);
+        if (st->pace_cycles != pace) {
+            deadline = seq_ccount();
+        }
+    }
+}
+
+// Each page is emitted at an absolute CCOUNT deadline, and the next deadline
+// is derived from the previous one rather than from when the write actually
+// happened, so loop overhead and bank handoffs never accumulate as drift.
+// Jitter is how late a write landed against its deadline.
+static void IRAM_ATTR run_timed(app_cpu_state_t *st) {
+    uint32_t deadline = seq_ccount() + TIMED_PAGE_MIN_CYCLES;
+    uint32_t prev_cycles = TIMED_PAGE_MIN_CYCLES;
+    while (st->bank != 0xFF && pattern_format == PATTERN_TIMED) {
+        const volatile timed_page_t *page =
+            (const volatile timed_page_t *)arena + st->bank * pages;
+        const volatile timed_page_t *end = page + pages;
+        while (page != end) {
+            uint32_t set = page->set;
+            uint32_t clear = page->clear;
+            uint32_t now;
+            // Capture only runs in the slack before a deadline; a sample
+            // landing right on it shows up as jitter.
+            while ((int32_t)(seq_ccount() - deadline) < 0) {
+                poll_capture();
+            }
+            do {
+                now = seq_ccount();
+            } while ((int32_t)(now - deadline) < 0);
+            seq_out(set, clear);
+            record_page(now, prev_cycles);
+
+            uint32_t late = now - deadline;
+            if (late > timed_worst_jitter) {
+                timed_worst_jitter = late;
+            }
+            if (late >= page->cycles) {
+                timed_late_pages++;
+            }
+            prev_cycles = page->cycles;
+            deadline += prev_cycles;
+            page++;
+            cpu1_counter++;
+        }
+        poll_mailbox(st);
+    }
+}
+
+static inline void IRAM_ATTR run_page(uint32_t set, uint32_t clear,
+                                      uint32_t n, uint32_t pace,
+                                      uint32_t *deadline) {
+    if (pace == 0) {
+        while (n--) {
+            seq_out(set, clear);
+            record_page(seq_ccount(), 0);
+            cpu1_counter++;
+            poll_capture();
+        }
+        return;
+    }
+    while (n--) {
+        while ((int32_t)(seq_ccount() - *deadline) < 0) {
+            poll_capture();
+        }
+        seq_out(set, clear);
+        record_page(seq_ccount(), pace);
+        *deadline += pace;
+        cpu1_counter++;
+    }
+}
+
+// Decodes the bank's program as it plays. Programs were checked by
+// rle_validate() when written; anything unexpected just ends the cycle.
+static void IRAM_ATTR run_rle(app_cpu_state_t *st) {
+    uint32_t deadline = seq_ccount();
+    while (st->bank != 0xFF && pattern_format == PATTERN_RLE) {
+        const volatile uint32_t *pc = prog_at(st->bank);
+        const volatile uint32_t *loop_pc[RLE_MAX_DEPTH];
+        uint32_t loop_left[RLE_MAX_DEPTH];
+        int depth = 0;
+        uint32_t pace = st->pace_cycles;
+        while (true) {
+            uint32_t word = *pc;
+            uint32_t op = RLE_GET_OP(word);
+            if (op == RLE_OP_PAGE) {
+                run_page(pc[1], pc[2], RLE_GET_COUNT(word), pace, &deadline);
+                pc += 3;
+            } else if (op == RLE_OP_LOOP && depth < RLE_MAX_DEPTH) {
+                loop_pc[depth] = pc + 1;
+                loop_left[depth] = RLE_GET_COUNT(word);
+                depth++;
+                pc++;
+            } else if (op == RLE_OP_END && depth > 0) {
+                if (--loop_left[depth - 1] != 0) {
+                    pc = loop_pc[depth - 1];
+                } else {
+                    depth--;
+                    pc++;
+                }
+            } else {
+                break;
+            }
+        }
+        poll_mailbox(st);
+        if (st->pace_cycles != pace) {
+            deadline = seq_ccount();
+        }
+    }
+}
+
+void IRAM_ATTR sequencer_main(void) {
+    app_cpu_state_t st = {.bank = 0xFF, .pace_cycles = 0};
+    active_bank = 0xFF;
+    while (1) {
+        if (st.bank != 0xFF) {
+            // Time spent stopped or parked is not a page period.
+            page_stats.last = seq_ccount();
+            if (pattern_format == PATTERN_TIMED) {
+                run_timed(&st);
+            } else if (pattern_format == PATTERN_RLE) {
+                run_rle(&st);
+            } else {
+                run_untimed(&st);
+            }
+        }
+        poll_mailbox(&st);
+        poll_capture();
+        if (st.bank == 0xFF && !capture_enabled) {
+            park_app_cpu();
+        }
+    }
+}
+
@@ -0,0 +1,190 @@
+/**
+ * Copyright 2022 Patrick Erley <paerley@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// Host only, not part of the firmware build.
+#ifdef SEQUENCER_HOST
+#include "sequencer-port.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sequencer-core.h"
+
+// Same single writer per index scheme as the capture ring: the sequencer
+// thread owns head, the harness owns tail.
+typedef struct sim_port {
+    sim_event_t *buf;
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;
+    uint32_t out;
+    uint32_t enable;
+    uint32_t in;
+    uint32_t in1;
+    bool halted;
+    void (*notify)(void *);
+} sim_port_t;
+
+static sim_port_t sim = {0};
+static pthread_t app_cpu_thread;
+
+#define LOAD(X) __atomic_load_n(&(X), __ATOMIC_ACQUIRE)
+#define STORE(X, V) __atomic_store_n(&(X), (V), __ATOMIC_RELEASE)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint32_t seq_ccount() {
+    return (uint32_t)(now_ns() * (SIM_CPU_HZ / 1000000) / 1000);
+}
+
+void seq_out(uint32_t set, uint32_t clear) {
+    uint32_t out = (sim.out | set) & ~clear;
+    STORE(sim.out, out);
+
+    uint32_t head = sim.head;
+    if (head - LOAD(sim.tail) > sim.mask) {
+        STORE(sim.dropped, sim.dropped + 1);
+        return;
+    }
+    sim_event_t *ev = &sim.buf[head & sim.mask];
+    ev->ccount = seq_ccount();
+    ev->set = set;
+    ev->clear = clear;
+    STORE(sim.head, head + 1);
+}
+
+void seq_in(uint32_t *in, uint32_t *in1) {
+    *in = LOAD(sim.in);
+    *in1 = LOAD(sim.in1);
+}
+
+void seq_notify() {
+    void (*cb)(void *) = LOAD(sim.notify);
+    if (cb != NULL) {
+        cb(NULL);
+    }
+}
+
+void seq_halt() {
+    STORE(sim.halted, true);
+    while (LOAD(sim.halted)) {
+        struct timespec ts = {.tv_sec = 0, .tv_nsec = 10000};
+        nanosleep(&ts, NULL);
+    }
+}
+
+int64_t seq_time_us() {
+    return now_ns() / 1000;
+}
+
+// Only the PRO cpu side enables outputs.
+void seq_enable(uint32_t set, uint32_t clear) {
+    STORE(sim.enable, (sim.enable | set) & ~clear);
+}
+
+bool seq_running() {
+    return !LOAD(sim.halted);
+}
+
+void seq_resume() {
+    sim_wake();
+}
+
+void seq_spin() {
+    sched_yield();
+}
+
+// Host memory is all one kind.
+void *seq_alloc(size_t bytes, bool exec) {
+    return malloc(bytes);
+}
+
+void seq_free(void *ptr) {
+    free(ptr);
+}
+
+bool sim_init(size_t events) {
+    if (events < 2 || (events & (events - 1))) {
+        return false;
+    }
+    sim_deinit();
+    sim.buf = calloc(events, sizeof(sim_event_t));
+    if (sim.buf == NULL) {
+        return false;
+    }
+    sim.mask = events - 1;
+    return true;
+}
+
+void sim_deinit() {
+    free(sim.buf);
+    sim = (sim_port_t){0};
+}
+
+size_t sim_events(sim_event_t *out, size_t max) {
+    uint32_t tail = sim.tail;
+    uint32_t avail = LOAD(sim.head) - tail;
+    if (avail > max) {
+        avail = max;
+    }
+    for (uint32_t i = 0; i < avail; i++) {
+        out[i] = sim.buf[(tail + i) & sim.mask];
+    }
+    STORE(sim.tail, tail + avail);
+    return avail;
+}
+
+uint32_t sim_dropped() {
+    return LOAD(sim.dropped);
+}
+
+uint32_t sim_out_state() {
+    return LOAD(sim.out);
+}
+
+void sim_set_inputs(uint32_t in, uint32_t in1) {
+    STORE(sim.in, in);
+    STORE(sim.in1, in1);
+}
+
+void sim_set_notify(void (*cb)(void *)) {
+    STORE(sim.notify, cb);
+}
+
+void sim_wake() {
+    STORE(sim.halted, false);
+}
+
+static void *app_cpu_main(void *arg) {
+    sequencer_main();
+    return NULL;
+}
+
+bool sim_start(void (*isr)(void *)) {
+    sim_set_notify(isr);
+    return pthread_create(&app_cpu_thread, NULL, app_cpu_main, NULL) == 0;
+}
+
+uint32_t sim_enabled() {
+    return LOAD(sim.enable);
+}
+#endif
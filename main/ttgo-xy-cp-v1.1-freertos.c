@@ -2,7 +2,9 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "display-profile.h"
 #include "driver/gpio.h"
+#include "esp32/clk.h"
 #include "esp_log.h"
 #include "esp_spi_flash.h"
 #include "esp_system.h"
@@ -12,6 +14,7 @@
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "screen-core.h"
+#include "screen-fluke8050.h"
 #include "sdkconfig.h"
 #include "task-button.h"
 
@@ -39,7 +42,7 @@ worker_data_t *alloc_data() {
 
     wdata->button_data = init_buttons(2);
 
-    wdata->disp_data = init_display(1);
+    wdata->disp_data = init_display(MAX_DISPLAY_MODE + 1);
 
     // voltage_worker_init(&wdata->adc_data);
 
@@ -50,7 +53,7 @@ worker_data_t *alloc_data() {
 #define BUTTON2 GPIO_NUM_0
 #define TFT_BL GPIO_NUM_4
 
-int8_t screen = 0;
+display_mode_t screen = FLUKE_8050A;
 
 uint16_t brightness = 0;
 
@@ -78,6 +81,37 @@ void button2_evt(int64_t etime, event_t evt, button_callback_param_t parm) {
     set_brightness(brightness);
 }
 
+// Both buttons together step through the screens.
+void both_buttons_evt(int64_t etime, event_t evt,
+                      button_callback_param_t parm) {
+    const char *tag = "b1+b2";
+    screen = next_display_mode(parm, screen);
+    ESP_LOGI(tag, "Screen %d", screen);
+    show_display(parm, screen);
+}
+
+// Holding a button steps the derived reading: button 1 its mode, button 2
+// the mode's setting.
+void button1_long_evt(int64_t etime, event_t evt,
+                      button_callback_param_t parm) {
+    fluke8050_derived_next_mode();
+    display_wake(parm);
+}
+
+void button2_long_evt(int64_t etime, event_t evt,
+                      button_callback_param_t parm) {
+    fluke8050_derived_next_param();
+    display_wake(parm);
+}
+
+// Holding both toggles the frame profiler overlay and dumps its frames to
+// the console.
+void both_buttons_long_evt(int64_t etime, event_t evt,
+                           button_callback_param_t parm) {
+    profile_toggle();
+    display_wake(parm);
+}
+
 void setup_buttons(worker_data_t *wdata) {
     button_spec_t button1 = {
         .active_level = LOW, .gpio_num = BUTTON1, .pull_mode = GPIO_FLOATING};
@@ -106,13 +140,99 @@ void setup_buttons(worker_data_t *wdata) {
                              .release_param = wdata->disp_data};
 
     attach_callback(wdata->button_data, &cb2);
+
+    button_callback_t cb3 = {.button_mask = 1 << b1 | 1 << b2,
+                             .min_time = 100000,
+                             .max_time = 2000000,
+                             .release_cb = both_buttons_evt,
+                             .release_param = wdata->disp_data};
+
+    attach_callback(wdata->button_data, &cb3);
+
+    button_callback_t cb4 = {.button_mask = 1 << b1,
+                             .ignore_mask = 1 << b2,
+                             .min_time = 2000000,
+                             .max_time = 10000000,
+                             .release_cb = button1_long_evt,
+                             .release_param = wdata->disp_data};
+
+    attach_callback(wdata->button_data, &cb4);
+
+    button_callback_t cb5 = {.button_mask = 1 << b2,
+                             .ignore_mask = 1 << b1,
+                             .min_time = 2000000,
+                             .max_time = 10000000,
+                             .release_cb = button2_long_evt,
+                             .release_param = wdata->disp_data};
+
+    attach_callback(wdata->button_data, &cb5);
+
+    button_callback_t cb6 = {.button_mask = 1 << b1 | 1 << b2,
+                             .min_time = 2000000,
+                             .max_time = 10000000,
+                             .release_cb = both_buttons_long_evt,
+                             .release_param = wdata->disp_data};
+
+    attach_callback(wdata->button_data, &cb6);
 }
 
 #include "esp32-cpu1.h"
+#include "fluke8050-bus.h"
+#include "sequencer-bench.h"
+#include "derived-bench.h"
+#include "fluke8050-bench.h"
+#include "fluke8050-selftest.h"
+#include "pattern-wave.h"
+
+// Quadrature square waves on GPIO25/26 from the APP cpu, kept off the meter
+// pins.
+static void start_demo_pattern() {
+    static const char *tag = "demo";
+    static const wave_pin_t demo[] = {
+        {.pin = 25, .kind = WAVE_CLOCK, .hz = 100000, .duty = 50},
+        {.pin = 26, .kind = WAVE_CLOCK, .hz = 100000, .duty = 50, .phase = 90}};
+    uint32_t w1ts[4];
+    uint32_t w1tc[4];
+    wave_program_t prog;
+    wave_status_t err = wave_compile_flat(demo, 2, esp_clk_cpu_freq(), w1ts,
+                                          w1tc, 4, &prog);
+    if (err != WAVE_OK) {
+        ESP_LOGE(tag, "%s", wave_strerror(err));
+        return;
+    }
+    init_gpios(2, prog.pages);
+    write_set_bank(0, 0, prog.pages, w1ts);
+    write_clear_bank(0, 0, prog.pages, w1tc);
+    set_pacing(prog.step_cycles);
+    set_active_bank(0);
+}
+
 void app_main(void) {
     static const char *tag = "main";
     ESP_LOGI(tag, "Main start");
 
+#ifdef SEQUENCER_BENCHMARK
+    sequencer_benchmark();
+#endif
+#ifdef DERIVED_BENCHMARK
+    derived_benchmark();
+#endif
+#ifdef FLUKE8050_DECODE_BENCHMARK
+    fluke8050_decode_benchmark();
+#endif
+#ifdef FLUKE8050_SELFTEST
+    fluke8050_selftest_config_t selftest_cfg =
+        FLUKE8050_SELFTEST_DEFAULT_CONFIG;
+    fluke8050_selftest(&selftest_cfg);
+#endif
+
+    ESP_LOGI(tag, "Starting Fluke 8050A bus decoder");
+    fluke8050_bus_config_t bus_cfg = FLUKE8050_BUS_DEFAULT_CONFIG;
+    if (!fluke8050_bus_start(&bus_cfg)) {
+        ESP_LOGE(tag, "No bus decoder, readings will not update");
+    }
+    start_demo_pattern();
+
     ESP_LOGI(tag, "Allocating objects");
     worker_data_t *wdata = alloc_data();
 
@@ -122,6 +242,9 @@ void app_main(void) {
     ESP_LOGI(tag, "Enabling Buttons");
     setup_buttons(wdata);
 
+    // Readings go straight to the screen instead of waiting for its tick.
+    fluke8050_bus_set_listener(display_wake, wdata->disp_data);
+
     while (1) {
         ESP_LOGI(tag, "Looping forever.");
         vTaskDelay(portMAX_DELAY);